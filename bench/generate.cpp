@@ -0,0 +1,125 @@
+/**
+ * generate.cpp
+ *
+ * Purpose: Synthetic transaction log generator for the benchmarks
+ * Writes one item per line with Zipf distributed popularity until the output
+ * reaches the requested size, which may be many gigabytes. Output goes
+ * through a large buffer so generation is not the bottleneck.
+ *
+ * Usage: ./generate [--items N] [--skew S] [--size BYTES[K|M|G]] [--seed N] [--timestamps] [--output PATH]
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "zipf.h"
+
+/**
+ * Parses a byte count with an optional K, M or G suffix.
+ *
+ * @param t_str the text to parse
+ * @param t_bytes the parsed byte count
+ * @return true if the text is a positive byte count, false otherwise
+ */
+static bool tryParseSize(const std::string& t_str, unsigned long long& t_bytes) {
+    char* end;
+    unsigned long long value = std::strtoull(t_str.c_str(), &end, 10);
+    unsigned long long scale = 1;
+    if (*end == 'K' || *end == 'k') {
+        scale = 1ULL << 10;
+        end++;
+    } else if (*end == 'M' || *end == 'm') {
+        scale = 1ULL << 20;
+        end++;
+    } else if (*end == 'G' || *end == 'g') {
+        scale = 1ULL << 30;
+        end++;
+    }
+    if (end == t_str.c_str() || *end != '\0' || value == 0) {
+        return false;
+    }
+    t_bytes = value * scale;
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    size_t itemCount = 10000;
+    double skew = 1.1;
+    unsigned long long size = 64ULL << 20;
+    unsigned long long seed = 1;
+    bool timestamps = false;
+    std::string outputFileName = "-";
+    for (int i = 1; i < argc; i++) {
+        std::string argument = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (argument == "--items" && hasValue) {
+            itemCount = static_cast<size_t>(std::strtoull(argv[++i], nullptr, 10));
+        } else if (argument == "--skew" && hasValue) {
+            skew = std::strtod(argv[++i], nullptr);
+        } else if (argument == "--size" && hasValue) {
+            if (!tryParseSize(argv[++i], size)) {
+                std::cerr << "Invalid size: " << argv[i] << std::endl;
+                return 1;
+            }
+        } else if (argument == "--seed" && hasValue) {
+            seed = std::strtoull(argv[++i], nullptr, 10);
+        } else if (argument == "--timestamps") {
+            timestamps = true;
+        } else if (argument == "--output" && hasValue) {
+            outputFileName = argv[++i];
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--items N] [--skew S] [--size BYTES[K|M|G]] [--seed N] [--timestamps] [--output PATH]" << std::endl;
+            return 1;
+        }
+    }
+    if (itemCount == 0 || skew < 0) {
+        std::cerr << "The item count must be positive and the skew not negative" << std::endl;
+        return 1;
+    }
+
+    std::FILE* output = outputFileName == "-" ? stdout : std::fopen(outputFileName.c_str(), "wb");
+    if (output == nullptr) {
+        std::cerr << "Failed to open output file: " << outputFileName << std::endl;
+        return 1;
+    }
+
+    // Names are built once; the hot loop only copies bytes
+    std::vector<std::string> names(itemCount);
+    for (size_t i = 0; i < itemCount; i++) {
+        names[i] = syntheticItemName(i) + "\n";
+    }
+    ZipfSampler sampler(itemCount, skew, seed);
+
+    // Timestamped lines start at 2025-06-20T00:00 and advance one second per line
+    const size_t bufferSize = 1 << 20;
+    std::vector<char> buffer;
+    buffer.reserve(bufferSize + 64);
+    unsigned long long written = 0;
+    unsigned long long seconds = 1750377600ULL;
+    char stamp[32];
+    while (written < size) {
+        if (timestamps) {
+            int length = std::snprintf(stamp, sizeof(stamp), "%llu ", seconds++);
+            buffer.insert(buffer.end(), stamp, stamp + length);
+        }
+        const std::string& name = names[sampler.next()];
+        buffer.insert(buffer.end(), name.begin(), name.end());
+        if (buffer.size() >= bufferSize || written + buffer.size() >= size) {
+            if (std::fwrite(buffer.data(), 1, buffer.size(), output) != buffer.size()) {
+                std::cerr << "Failed to write output" << std::endl;
+                return 1;
+            }
+            written += buffer.size();
+            buffer.clear();
+        }
+    }
+    if (output != stdout && std::fclose(output) != 0) {
+        std::cerr << "Failed to write output" << std::endl;
+        return 1;
+    }
+    return 0;
+}
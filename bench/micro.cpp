@@ -0,0 +1,266 @@
+/**
+ * micro.cpp
+ *
+ * Purpose: Micro benchmarks for the inventory analyzer's building blocks
+ * Compiles main.cpp into the same program, without its main function, and times
+ * the tokenizer, item table, count index, lookups, searches, buffered output, row
+ * rendering and approximate counting on Zipf distributed tokens. Results are
+ * written to stdout as JSON.
+ *
+ * Usage: ./micro [--items N] [--skew S] [--tokens N] [--seed N]
+ */
+
+#define INVENTORY_ANALYZER_NO_MAIN
+#include "../main.cpp"
+
+#include "zipf.h"
+
+#include <sstream>
+
+/**
+ * Times repeated calls of an operation and writes the result as one JSON member.
+ */
+class MicroBenchmark {
+private:
+    bool m_first = true;
+
+public:
+    /**
+     * Runs an operation and reports the time per call.
+     *
+     * @param t_name the benchmark name
+     * @param t_operations the number of calls the operation makes in total
+     * @param t_operation the work to time, run once
+     */
+    template <typename Operation>
+    void run(const char* t_name, size_t t_operations, Operation t_operation) {
+        auto start = std::chrono::steady_clock::now();
+        t_operation();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::printf("%s\n    \"%s\": {\"operations\": %llu, \"seconds\": %.6f, \"ns_per_operation\": %.2f, \"operations_per_second\": %.1f}",
+                    m_first ? "" : ",", t_name, static_cast<unsigned long long>(t_operations), seconds,
+                    seconds * 1e9 / t_operations, t_operations / seconds);
+        m_first = false;
+    }
+
+    /**
+     * Runs an operation over a number of bytes and reports its throughput. Cycles are read
+     * from the time stamp counter on x86-64, which ticks at the nominal clock rate.
+     *
+     * @param t_name the benchmark name
+     * @param t_bytes the number of bytes the operation processes
+     * @param t_operation the work to time, run once
+     */
+    template <typename Operation>
+    void runThroughput(const char* t_name, size_t t_bytes, Operation t_operation) {
+    #ifdef TOKEN_SCANNER_SIMD
+        unsigned long long startCycles = __rdtsc();
+    #endif
+        auto start = std::chrono::steady_clock::now();
+        t_operation();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    #ifdef TOKEN_SCANNER_SIMD
+        double cycles = static_cast<double>(__rdtsc() - startCycles);
+        char bytesPerCycle[32];
+        std::snprintf(bytesPerCycle, sizeof(bytesPerCycle), "%.3f", t_bytes / cycles);
+    #else
+        const char* bytesPerCycle = "null";
+    #endif
+        std::printf("%s\n    \"%s\": {\"bytes\": %llu, \"seconds\": %.6f, \"mb_per_second\": %.1f, \"bytes_per_cycle\": %s}",
+                    m_first ? "" : ",", t_name, static_cast<unsigned long long>(t_bytes), seconds, t_bytes / seconds / 1e6, bytesPerCycle);
+        m_first = false;
+    }
+};
+
+int main(int argc, char* argv[]) {
+    size_t itemCount = 10000;
+    double skew = 1.1;
+    size_t tokenCount = 2000000;
+    unsigned long long seed = 1;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string argument = argv[i];
+        if (argument == "--items") {
+            itemCount = static_cast<size_t>(std::strtoull(argv[i + 1], nullptr, 10));
+        } else if (argument == "--skew") {
+            skew = std::strtod(argv[i + 1], nullptr);
+        } else if (argument == "--tokens") {
+            tokenCount = static_cast<size_t>(std::strtoull(argv[i + 1], nullptr, 10));
+        } else if (argument == "--seed") {
+            seed = std::strtoull(argv[i + 1], nullptr, 10);
+        }
+    }
+    if (itemCount == 0 || tokenCount == 0) {
+        std::cerr << "Usage: " << argv[0] << " [--items N] [--skew S] [--tokens N] [--seed N]" << std::endl;
+        return 1;
+    }
+
+    // Tokens point into one buffer laid out like an input file
+    ZipfSampler sampler(itemCount, skew, seed);
+    std::string text;
+    std::vector<StringView> tokens;
+    std::vector<size_t> offsets;
+    for (size_t i = 0; i < tokenCount; i++) {
+        offsets.push_back(text.size());
+        text += syntheticItemName(sampler.next());
+        text += '\n';
+    }
+    for (size_t i = 0; i < tokenCount; i++) {
+        size_t end = i + 1 < tokenCount ? offsets[i + 1] : text.size();
+        tokens.push_back(StringView(text.data() + offsets[i], end - offsets[i] - 1));
+    }
+    std::vector<std::string> upperNames;
+    for (size_t i = 0; i < std::min<size_t>(tokenCount, 100000); i++) {
+        std::string name = tokens[i].str();
+        std::transform(name.begin(), name.end(), name.begin(), [](char c) {
+            return static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+        });
+        upperNames.push_back(name);
+    }
+    volatile size_t sink = 0;
+
+    std::printf("{\n  \"config\": {\"items\": %llu, \"skew\": %.3f, \"tokens\": %llu, \"seed\": %llu},\n  \"micro\": {",
+                static_cast<unsigned long long>(itemCount), skew, static_cast<unsigned long long>(tokenCount), seed);
+    MicroBenchmark bench;
+
+    // Tokenizer, stream extraction with trimming against the byte loop and the block scanner
+    bench.runThroughput("tokenize_stream_trim", text.size(), [&]() {
+        std::istringstream stream(text);
+        std::string token;
+        while (stream >> token) {
+            sink += Utils::trim(token).size();
+        }
+    });
+    bench.runThroughput("tokenize_bytewise", text.size(), [&]() {
+        const char* cursor = text.data();
+        const char* end = text.data() + text.size();
+        while (cursor < end) {
+            while (cursor < end && Utils::isWhitespace(*cursor)) {
+                ++cursor;
+            }
+            const char* tokenStart = cursor;
+            while (cursor < end && !Utils::isWhitespace(*cursor)) {
+                ++cursor;
+            }
+            sink += cursor - tokenStart;
+        }
+    });
+    const TokenScanner::InstructionSet instructionSets[] = {TokenScanner::SCALAR, TokenScanner::SSE2, TokenScanner::AVX2};
+    for (TokenScanner::InstructionSet set : instructionSets) {
+        if (!TokenScanner::isSupported(set)) {
+            continue;
+        }
+        std::string name = std::string("tokenize_blocks_") + TokenScanner::getName(set);
+        bench.runThroughput(name.c_str(), text.size(), [&]() {
+            TokenScanner::forEachToken(text.data(), text.data() + text.size(), [&](const char* t_start, const char* t_end) {
+                sink += t_end - t_start;
+            }, set);
+        });
+    }
+
+    // Item table
+    ItemTable table;
+    bench.run("item_table_add", tokens.size(), [&]() {
+        for (StringView token : tokens) {
+            table.add(token);
+        }
+    });
+    bench.run("item_table_find", tokens.size(), [&]() {
+        for (StringView token : tokens) {
+            sink += table.find(token);
+        }
+    });
+    bench.run("item_table_find_any_case", upperNames.size(), [&]() {
+        for (const std::string& name : upperNames) {
+            sink += table.findFolded(name);
+        }
+    });
+
+    // Count index
+    CountIndex countIndex;
+    const size_t rebuilds = 20;
+    bench.run("count_index_rebuild", rebuilds, [&]() {
+        for (size_t i = 0; i < rebuilds; i++) {
+            countIndex.rebuild(table);
+        }
+    });
+    const size_t topQueries = 100000;
+    bench.run("top_10", topQueries, [&]() {
+        for (size_t i = 0; i < topQueries; i++) {
+            sink += countIndex.top(10, table).size();
+        }
+    });
+
+    // Database queries on the same tokens read back from a file
+    std::string inputFileName = "micro_input.tmp";
+    std::string backupFileName = "micro_backup.tmp";
+    {
+        std::ofstream input(inputFileName, std::ios::binary);
+        input << text;
+    }
+    std::ostream quiet(nullptr);
+    Database database;
+    database.setStatusStream(quiet);
+    bench.run("database_build_file", tokens.size(), [&]() {
+        database.buildDatabaseFromFile(inputFileName);
+    });
+    const size_t lookups = std::min<size_t>(tokens.size(), 200000);
+    bench.run("database_lookup", lookups, [&]() {
+        ItemTable::ItemId id;
+        for (size_t i = 0; i < lookups; i++) {
+            sink += database.tryFindItem(upperNames[i % upperNames.size()], id) ? id : 0;
+        }
+    });
+    const size_t prefixQueries = 1000;
+    bench.run("prefix_search", prefixQueries, [&]() {
+        for (size_t i = 0; i < prefixQueries; i++) {
+            sink += database.findItemsByPrefix(upperNames[i % upperNames.size()].substr(0, 3), 10).size();
+        }
+    });
+    const size_t fuzzyQueries = 100;
+    bench.run("fuzzy_search", fuzzyQueries, [&]() {
+        for (size_t i = 0; i < fuzzyQueries; i++) {
+            std::string misspelled = upperNames[i % upperNames.size()];
+            misspelled[misspelled.size() / 2] = 'x';
+            sink += database.findSimilarItems(misspelled, 5).size();
+        }
+    });
+    bench.run("backup_write", database.getItemTotal(), [&]() {
+        database.writeDatabaseBackup(backupFileName);
+    });
+    std::remove(inputFileName.c_str());
+    std::remove(backupFileName.c_str());
+    std::remove((backupFileName + ".snapshot").c_str());
+    std::remove((backupFileName + ".checkpoint").c_str());
+
+    // Output
+    std::FILE* devNull = std::fopen("/dev/null", "wb");
+    bench.run("buffered_writer_record", tokens.size(), [&]() {
+        BufferedWriter output(devNull);
+        for (StringView token : tokens) {
+            output.write(token);
+            output.write(' ');
+            output.writeNumber(static_cast<long long>(token.size()));
+            output.write('\n');
+        }
+        output.flush();
+    });
+    std::fclose(devNull);
+    const size_t rows = std::min<size_t>(tokens.size(), 200000);
+    bench.run("render_row", rows, [&]() {
+        for (size_t i = 0; i < rows; i++) {
+            sink += Utils::centerStrings(tokens[i].str(), std::to_string(i), 80).size();
+        }
+    });
+
+    // Approximate counting
+    ApproximateCounter approximate;
+    approximate.configure(0.001, 0.01);
+    bench.run("approximate_add", tokens.size(), [&]() {
+        for (StringView token : tokens) {
+            approximate.add(token);
+        }
+    });
+
+    std::printf("\n  }\n}\n");
+    return 0;
+}
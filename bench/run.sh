@@ -0,0 +1,85 @@
+#!/bin/bash
+
+# Corner Grocer Inventory Analyzer - Benchmark Runner
+# Generates a synthetic transaction log, runs the micro benchmarks and times
+# the analyzer end to end with --stats-json, then combines everything into one
+# JSON file that can be compared across versions.
+#
+# Usage: bench/run.sh MAIN GENERATE MICRO
+# Settings come from the environment: BENCH_ITEMS, BENCH_SKEW, BENCH_SIZE,
+# BENCH_SEED, BENCH_TOKENS, BENCH_DATA_DIR and BENCH_OUTPUT.
+
+set -e
+
+MAIN=${1:?usage: run.sh MAIN GENERATE MICRO}
+GENERATE=${2:?usage: run.sh MAIN GENERATE MICRO}
+MICRO=${3:?usage: run.sh MAIN GENERATE MICRO}
+ITEMS=${BENCH_ITEMS:-10000}
+SKEW=${BENCH_SKEW:-1.1}
+SIZE=${BENCH_SIZE:-256M}
+SEED=${BENCH_SEED:-1}
+TOKENS=${BENCH_TOKENS:-2000000}
+DATA_DIR=${BENCH_DATA_DIR:-bench/data}
+OUTPUT=${BENCH_OUTPUT:-bench_results.json}
+
+mkdir -p "$DATA_DIR"
+INPUT="$DATA_DIR/transactions.txt"
+SETTINGS="$DATA_DIR/transactions.settings"
+STATS="$DATA_DIR/stats.json"
+
+# The log is only generated again when its settings change
+if [ ! -f "$INPUT" ] || [ "$(cat "$SETTINGS" 2>/dev/null)" != "$ITEMS $SKEW $SIZE $SEED" ]; then
+    echo "Generating $SIZE of transactions over $ITEMS items with skew $SKEW..."
+    "$GENERATE" --items "$ITEMS" --skew "$SKEW" --size "$SIZE" --seed "$SEED" --output "$INPUT"
+    echo "$ITEMS $SKEW $SIZE $SEED" > "$SETTINGS"
+fi
+
+# Runs the analyzer on the log and prints its statistics as a JSON member
+# Arguments: the scenario name, then the analyzer options
+run_scenario() {
+    local name=$1
+    shift
+    echo "Running $name..." >&2
+    rm -f "$STATS"
+    "$MAIN" --stats-json "$STATS" "$@" > /dev/null 2>&1
+    printf ',\n    "%s": %s' "$name" "$(sed -e '2,$s/^/    /' "$STATS")"
+}
+
+# Runs the analyzer with the log on standard input
+run_stream_scenario() {
+    local name=$1
+    shift
+    echo "Running $name..." >&2
+    rm -f "$STATS"
+    "$MAIN" --stats-json "$STATS" --input - "$@" < "$INPUT" > /dev/null 2>&1
+    printf ',\n    "%s": %s' "$name" "$(sed -e '2,$s/^/    /' "$STATS")"
+}
+
+echo "Running micro benchmarks..."
+MICRO_RESULTS=$("$MICRO" --items "$ITEMS" --skew "$SKEW" --tokens "$TOKENS" --seed "$SEED")
+
+BACKUP="$DATA_DIR/frequency.dat"
+rm -f "$BACKUP" "$BACKUP.checkpoint" "$BACKUP.snapshot"
+MACRO_RESULTS=$(
+    run_scenario ingest_one_thread --input "$INPUT" --no-backup --top 10
+    run_scenario ingest_all_threads --input "$INPUT" --no-backup --threads 0 --top 10
+    run_stream_scenario ingest_stream --no-backup --top 10
+    run_scenario ingest_approximate --input "$INPUT" --no-backup --approximate 0.001 --top 10
+    run_scenario backup_write --input "$INPUT" --output "$BACKUP" --rebuild --top 10
+    run_scenario resume_from_backup --input "$INPUT" --output "$BACKUP" --top 10
+    run_scenario queries --input "$INPUT" --no-backup --query Peaches,PEACHES,Kiwi7,Nothing --prefix Pea --suggest Peachs --top 100 --range 1-1000
+    run_scenario report_numerical --input "$INPUT" --no-backup --report numerical
+    run_scenario report_json --input "$INPUT" --no-backup --report numerical --format json
+)
+rm -f "$STATS" "$BACKUP" "$BACKUP.checkpoint" "$BACKUP.snapshot"
+
+# Label the results so runs of different versions can be told apart
+VERSION=$(git describe --always --dirty 2>/dev/null || echo unknown)
+{
+    printf '{\n  "version": "%s",\n  "date": "%s",\n  "input_bytes": %s,\n' "$VERSION" "$(date -u +%Y-%m-%dT%H:%M:%SZ)" "$(wc -c < "$INPUT" | tr -d ' ')"
+    echo "$MICRO_RESULTS" | sed -e '1d' -e '$d' | sed -e '$s/$/,/'
+    printf '  "macro": {'
+    echo "$MACRO_RESULTS" | sed -e '1s/^,//'
+    printf '\n  }\n}\n'
+} > "$OUTPUT"
+echo "Benchmark results written to $OUTPUT"
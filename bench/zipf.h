@@ -0,0 +1,82 @@
+/**
+ * zipf.h
+ *
+ * Purpose: Synthetic transactions for the benchmarks
+ * Item names and a Zipf distributed sampler shared by the data generator
+ * and the micro benchmarks, so both see the same skew for the same settings.
+ */
+
+#ifndef CORNER_GROCER_BENCH_ZIPF_H
+#define CORNER_GROCER_BENCH_ZIPF_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+/**
+ * Gets the name of the item with a given popularity rank.
+ * The first names are real produce; later ranks repeat them with a number appended.
+ *
+ * @param t_rank the rank, 0 for the best seller
+ * @return the item name, never containing whitespace
+ */
+inline std::string syntheticItemName(size_t t_rank) {
+    static const char* const produce[] = {
+        "Spinach", "Radishes", "Broccoli", "Peas", "Cranberries", "Potatoes", "Cucumbers", "Onions",
+        "Yams", "Zucchini", "Cantaloupe", "Pumpkins", "Cauliflower", "Celery", "Limes", "Beets",
+        "Apples", "Garlic", "Pears", "Peaches", "Kiwi", "Mangoes", "Lettuce", "Carrots",
+        "Tomatoes", "Grapes", "Plums", "Lemons", "Oranges", "Bananas", "Cherries", "Avocados"
+    };
+    const size_t produceCount = sizeof(produce) / sizeof(produce[0]);
+    std::string name = produce[t_rank % produceCount];
+    if (t_rank >= produceCount) {
+        name += std::to_string(t_rank / produceCount);
+    }
+    return name;
+}
+
+/**
+ * Draws item ranks with probability proportional to 1 / (rank + 1)^skew.
+ * A skew of 0 is uniform; around 1 matches typical retail sales.
+ */
+class ZipfSampler {
+private:
+    std::vector<double> m_cumulative;
+    std::mt19937_64 m_random;
+    std::uniform_real_distribution<double> m_uniform;
+
+public:
+    /**
+     * Prepares the distribution.
+     *
+     * @param t_itemCount the number of distinct items, at least 1
+     * @param t_skew the Zipf exponent, 0 or more
+     * @param t_seed the random seed, so runs can be repeated
+     */
+    ZipfSampler(size_t t_itemCount, double t_skew, uint64_t t_seed) : m_cumulative(t_itemCount), m_random(t_seed), m_uniform(0.0, 1.0) {
+        double total = 0;
+        for (size_t i = 0; i < t_itemCount; i++) {
+            total += 1.0 / std::pow(static_cast<double>(i + 1), t_skew);
+            m_cumulative[i] = total;
+        }
+        for (double& value : m_cumulative) {
+            value /= total;
+        }
+    }
+
+    /**
+     * Draws the next rank.
+     *
+     * @return a rank from 0 to the item count - 1
+     */
+    size_t next() {
+        double draw = m_uniform(m_random);
+        size_t rank = static_cast<size_t>(std::upper_bound(m_cumulative.begin(), m_cumulative.end(), draw) - m_cumulative.begin());
+        return std::min(rank, m_cumulative.size() - 1);
+    }
+};
+
+#endif
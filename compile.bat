@@ -44,7 +44,7 @@ echo.
 
 REM Compile the program
 echo Compiling main.cpp...
-g++ -std=c++11 -Wall -Wextra -pedantic -o main.exe main.cpp
+g++ -std=c++11 -Wall -Wextra -pedantic -pthread -o main.exe main.cpp
 
 REM Check if compilation was successful
 if %errorlevel% equ 0 (
@@ -39,7 +39,7 @@ echo ""
 
 # Compile the program
 echo "Compiling main.cpp..."
-g++ -std=c++11 -Wall -Wextra -pedantic -o main main.cpp
+g++ -std=c++11 -Wall -Wextra -pedantic -pthread -o main main.cpp
 
 # Check if compilation was successful
 if [ $? -eq 0 ]; then
@@ -27,26 +27,89 @@
  * Banana 1
  * Orange 1
  *
- * Usage: ./main
+ * Usage: ./main [--threads N] [--rebuild]
+ *        ./main --help
+ *        ./main --batch [--input PATH] [--output PATH] [--query ITEM[,ITEM...]] [--report numerical|histogram|none] [--format text|csv|json]
  */
 
 // --- Preprocessor Directives ---
 #include <iostream>
 #include <fstream>
-#include <map>
 #include <cmath>
 #include <thread>
 #include <chrono>
 #include <string>
 #include <vector>
+#include <atomic>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <cctype>
+#include <climits>
+#include <memory>
+#include <unordered_map>
+#include <cstdio>
+#include <cstdlib>
+#include <cerrno>
+#include <csignal>
+#include <ctime>
+#include <new>
 
 // Windows specific preprocessor directives
 #ifdef _WIN32
 #include <windows.h>
+#include <io.h>
+#include <conio.h>
+#include <fcntl.h>
+#else
+// POSIX specific preprocessor directives
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <termios.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <poll.h>
+#include <glob.h>
+#include <sys/resource.h>
+#endif
+
+// Linux specific preprocessor directives
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+
+// x86-64 SIMD intrinsics; SSE2 is always there, AVX2 is compiled per function and picked at run time
+#if defined(__x86_64__) || defined(_M_X64)
+#include <immintrin.h>
+#define TOKEN_SCANNER_SIMD
+#if defined(__GNUC__)
+#define TOKEN_SCANNER_AVX2_TARGET __attribute__((target("avx2")))
+#else
+#include <intrin.h>
+#define TOKEN_SCANNER_AVX2_TARGET
+#endif
 #endif
 
 // --- Class Definitions ---
 
+/**
+ * Console text colors, indexes into the escape sequence and console attribute tables.
+ */
+enum ConsoleColor {
+    COLOR_GREEN,
+    COLOR_RED,
+    COLOR_YELLOW,
+    COLOR_BLUE,
+    COLOR_MAGENTA,
+    COLOR_CYAN,
+    COLOR_GRAY,
+    COLOR_WHITE,
+    COLOR_COUNT
+};
+
 /**
  * Utility class for the inventory analyzer
  */
@@ -67,48 +130,47 @@ public:
      * Sets the console text color
      *
      * @param t_color the color to set
-     * @throws std::invalid_argument if the color is invalid
      */
-    static void setConsoleTextColor(const std::string& t_color) {
+    static void setConsoleTextColor(ConsoleColor t_color) {
     #ifdef _WIN32
-        // Windows color map
-        std::map<std::string, int> colorMap = {
-            {"green", FOREGROUND_GREEN | FOREGROUND_INTENSITY},
-            {"red", FOREGROUND_RED | FOREGROUND_INTENSITY},
-            {"yellow", FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_INTENSITY},
-            {"blue", FOREGROUND_BLUE | FOREGROUND_INTENSITY},
-            {"magenta", FOREGROUND_RED | FOREGROUND_BLUE | FOREGROUND_INTENSITY},
-            {"cyan", FOREGROUND_GREEN | FOREGROUND_BLUE | FOREGROUND_INTENSITY},
-            {"gray", FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_BLUE},
-            {"white", FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_BLUE | FOREGROUND_INTENSITY}
+        // Windows console attributes, in ConsoleColor order
+        static const WORD colorAttributes[COLOR_COUNT] = {
+            FOREGROUND_GREEN | FOREGROUND_INTENSITY,
+            FOREGROUND_RED | FOREGROUND_INTENSITY,
+            FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_INTENSITY,
+            FOREGROUND_BLUE | FOREGROUND_INTENSITY,
+            FOREGROUND_RED | FOREGROUND_BLUE | FOREGROUND_INTENSITY,
+            FOREGROUND_GREEN | FOREGROUND_BLUE | FOREGROUND_INTENSITY,
+            FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_BLUE,
+            FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_BLUE | FOREGROUND_INTENSITY
         };
-
-        // Validate the color
-        if (colorMap.find(t_color) == colorMap.end()) {
-            throw std::invalid_argument("Invalid color: " + t_color);
-        }
-        SetConsoleTextAttribute(GetStdHandle(STD_OUTPUT_HANDLE), colorMap[t_color]);
+        SetConsoleTextAttribute(GetStdHandle(STD_OUTPUT_HANDLE), colorAttributes[t_color]);
     #else
-        // Linux, macOS, color map
-        std::map<std::string, std::string> colorMap = {
-            {"green", "\033[92m"},
-            {"red", "\033[91m"},
-            {"yellow", "\033[93m"},
-            {"blue", "\033[94m"},
-            {"magenta", "\033[95m"},
-            {"cyan", "\033[96m"},
-            {"gray", "\033[90m"},
-            {"white", "\033[97m"}
-        };
-
-        // Validate the color
-        if (colorMap.find(t_color) == colorMap.end()) {
-            throw std::invalid_argument("Invalid color: " + t_color);
-        }
-        std::cout << colorMap[t_color];
+        std::cout << getConsoleColorCode(t_color);
     #endif
     }
 
+    /**
+     * Gets the ANSI escape sequence that sets the console text color.
+     *
+     * @param t_color the color to get the escape sequence for
+     * @return the escape sequence
+     */
+    static const char* getConsoleColorCode(ConsoleColor t_color) {
+        // Linux, macOS, escape sequences in ConsoleColor order
+        static const char* const colorCodes[COLOR_COUNT] = {
+            "\033[92m",
+            "\033[91m",
+            "\033[93m",
+            "\033[94m",
+            "\033[95m",
+            "\033[96m",
+            "\033[90m",
+            "\033[97m"
+        };
+        return colorCodes[t_color];
+    }
+
     /**
      * Clears the input buffer.
      */
@@ -146,39 +208,57 @@ public:
     }
 
     /**
-    * Opens an input file and checks if it exists.
-    *
-    * @param t_fileName the name of the file to open
-    * @param t_fileStream the file stream to open
-    * @return true if the file was opened successfully, false otherwise
-    */
-    static bool tryOpenInputFile(const std::string& t_fileName, std::ifstream& t_fileStream) {
-        std::cout << "Opening " << t_fileName << " for input...";
-        t_fileStream.open(t_fileName);
-        if (!t_fileStream.is_open()) {
-            std::cout << "ERROR" << std::endl << "Please make sure the file exists in the same directory as the program." << std::endl;
-            return false;
-        }
-        std::cout << "OK" << std::endl;
-        return true;
+     * Checks if a character is whitespace using the same rules as stream extraction.
+     * Whitespace characters are: space, tab, newline, vertical tab, form feed, and carriage return.
+     *
+     * @param t_char the character to check
+     * @return true if the character is whitespace, false otherwise
+     */
+    static bool isWhitespace(char t_char) {
+        return t_char == ' ' || (t_char >= '\t' && t_char <= '\r');
     }
 
     /**
-    * Opens an output file and checks if it exists and if the program has permission to create it.
-    *
-    * @param t_fileName the name of the file to open
-    * @param t_fileStream the file stream to open
-    * @return true if the file was opened successfully, false otherwise
-    */
-    static bool tryOpenOutputFile(const std::string& t_fileName, std::ofstream& t_fileStream) {
-        std::cout << "Opening " << t_fileName << " for output...";
-        t_fileStream.open(t_fileName);
-        if (!t_fileStream.is_open()) {
-            std::cout << "ERROR" << std::endl << "Please make sure the program has permission to create the file in the same directory as the program." << std::endl;
-            return false;
+     * Expands a file name pattern with *, ? or [...] wildcards to the files it matches.
+     * Shells expand unquoted patterns themselves; this covers quoted patterns and Windows.
+     *
+     * @param t_pattern the file name or pattern
+     * @return the matching file names in sorted order, or the pattern itself if it has no wildcards or matches nothing
+     */
+    static std::vector<std::string> expandFilePattern(const std::string& t_pattern) {
+        std::vector<std::string> fileNames;
+        if (t_pattern.find_first_of("*?[") == std::string::npos) {
+            fileNames.push_back(t_pattern);
+            return fileNames;
         }
-        std::cout << "OK" << std::endl;
-        return true;
+    #ifdef _WIN32
+        // Only the last path component may hold wildcards
+        size_t separator = t_pattern.find_last_of("/\\");
+        std::string directory = separator == std::string::npos ? "" : t_pattern.substr(0, separator + 1);
+        WIN32_FIND_DATAA found;
+        HANDLE search = FindFirstFileA(t_pattern.c_str(), &found);
+        if (search != INVALID_HANDLE_VALUE) {
+            do {
+                if (!(found.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)) {
+                    fileNames.push_back(directory + found.cFileName);
+                }
+            } while (FindNextFileA(search, &found));
+            FindClose(search);
+        }
+    #else
+        glob_t matches = glob_t();
+        if (glob(t_pattern.c_str(), 0, nullptr, &matches) == 0) {
+            for (size_t i = 0; i < matches.gl_pathc; i++) {
+                fileNames.push_back(matches.gl_pathv[i]);
+            }
+        }
+        globfree(&matches);
+    #endif
+        std::sort(fileNames.begin(), fileNames.end());
+        if (fileNames.empty()) {
+            fileNames.push_back(t_pattern);
+        }
+        return fileNames;
     }
 
     /**
@@ -281,6 +361,176 @@ public:
         }
     }
 
+    /**
+     * Parses a non-negative decimal number.
+     *
+     * @param t_str the string to parse
+     * @param t_maxValue the largest value accepted
+     * @param t_value the parsed value
+     * @return true if the string is a number no greater than t_maxValue, false otherwise
+     */
+    static bool tryParseUnsigned(const std::string& t_str, unsigned long long t_maxValue, unsigned long long& t_value) {
+        if (t_str.empty() || t_str.find_first_not_of("0123456789") != std::string::npos) {
+            return false;
+        }
+        unsigned long long value = 0;
+        for (char digit : t_str) {
+            if (value > (t_maxValue - (digit - '0')) / 10) {
+                return false;
+            }
+            value = value * 10 + (digit - '0');
+        }
+        t_value = value;
+        return true;
+    }
+
+    /**
+     * Parses a fraction strictly between 0 and 1, such as 0.001.
+     *
+     * @param t_str the string to parse
+     * @param t_value the parsed value
+     * @return true if the whole string is such a fraction, false otherwise
+     */
+    static bool tryParseFraction(const std::string& t_str, double& t_value) {
+        if (t_str.empty() || Utils::isWhitespace(t_str[0])) {
+            return false;
+        }
+        char* end;
+        double value = std::strtod(t_str.c_str(), &end);
+        if (*end != '\0' || !(value > 0 && value < 1)) {
+            return false;
+        }
+        t_value = value;
+        return true;
+    }
+
+    /**
+     * Gets the number of days in a month of the proleptic Gregorian calendar.
+     *
+     * @param t_year the year
+     * @param t_month the month, 1 to 12
+     * @return the number of days, 28 to 31
+     */
+    static unsigned int daysInMonth(unsigned int t_year, unsigned int t_month) {
+        static const unsigned int s_monthDays[12] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+        bool leapYear = (t_year % 4 == 0 && t_year % 100 != 0) || t_year % 400 == 0;
+        return t_month == 2 && leapYear ? 29 : s_monthDays[t_month - 1];
+    }
+
+    /**
+     * Counts the days from 1970-01-01 to a date in the proleptic Gregorian calendar.
+     *
+     * @param t_year the year
+     * @param t_month the month, 1 to 12
+     * @param t_day the day of the month, 1 to 31
+     * @return the number of days, negative before 1970
+     */
+    static long long daysFromCivil(long long t_year, unsigned int t_month, unsigned int t_day) {
+        t_year -= t_month <= 2 ? 1 : 0;
+        long long era = (t_year >= 0 ? t_year : t_year - 399) / 400;
+        unsigned int yearOfEra = static_cast<unsigned int>(t_year - era * 400);
+        unsigned int dayOfYear = (153 * (t_month + (t_month > 2 ? -3 : 9)) + 2) / 5 + t_day - 1;
+        unsigned int dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+        return era * 146097 + static_cast<long long>(dayOfEra) - 719468;
+    }
+
+    /**
+     * Parses a timestamp at the start of a transaction line.
+     * Accepts Unix seconds of 9 or 10 digits, from 1973 to 2286, so shorter numbers such as
+     * numeric item codes stay items, or an ISO 8601 date with an optional time, such as
+     * 2025-06-20, 2025-06-20T14:05 or 2025-06-20T14:05:09Z. Times carry no time zone.
+     *
+     * @param t_text the text to parse, not null terminated
+     * @param t_length the length of the text
+     * @param t_seconds the seconds since 1970-01-01T00:00
+     * @return true if the whole text is a timestamp, false otherwise
+     */
+    static bool tryParseTimestamp(const char* t_text, size_t t_length, long long& t_seconds) {
+        // Reads a fixed number of digits starting at an offset
+        auto readNumber = [t_text, t_length](size_t t_offset, size_t t_digits, unsigned int& t_value) {
+            if (t_offset + t_digits > t_length) {
+                return false;
+            }
+            t_value = 0;
+            for (size_t i = t_offset; i < t_offset + t_digits; i++) {
+                if (t_text[i] < '0' || t_text[i] > '9') {
+                    return false;
+                }
+                t_value = t_value * 10 + static_cast<unsigned int>(t_text[i] - '0');
+            }
+            return true;
+        };
+        if (t_length == 0) {
+            return false;
+        }
+
+        // Unix seconds
+        if (std::all_of(t_text, t_text + t_length, [](char c) { return c >= '0' && c <= '9'; })) {
+            if (t_length < 9 || t_length > 10) {
+                return false;
+            }
+            t_seconds = 0;
+            for (size_t i = 0; i < t_length; i++) {
+                t_seconds = t_seconds * 10 + (t_text[i] - '0');
+            }
+            return true;
+        }
+
+        // ISO 8601 date and optional time
+        unsigned int year, month, day, hour = 0, minute = 0, second = 0;
+        if (!readNumber(0, 4, year) || t_length < 10 || t_text[4] != '-' || !readNumber(5, 2, month) ||
+            t_text[7] != '-' || !readNumber(8, 2, day) || month < 1 || month > 12 || day < 1 || day > daysInMonth(year, month)) {
+            return false;
+        }
+        size_t end = 10;
+        if (end < t_length && t_text[end] == 'T') {
+            if (!readNumber(11, 2, hour) || t_length < 16 || t_text[13] != ':' || !readNumber(14, 2, minute) || hour > 23 || minute > 59) {
+                return false;
+            }
+            end = 16;
+            if (end < t_length && t_text[end] == ':') {
+                if (!readNumber(17, 2, second) || second > 60) {
+                    return false;
+                }
+                end = 19;
+            }
+        }
+        if (end < t_length && t_text[end] == 'Z') {
+            end++;
+        }
+        if (end != t_length) {
+            return false;
+        }
+        t_seconds = ((daysFromCivil(year, month, day) * 24 + hour) * 60 + minute) * 60 + second;
+        return t_seconds >= 0;
+    }
+
+    /**
+     * Formats seconds since 1970-01-01T00:00 as an ISO 8601 date and time to the minute.
+     *
+     * @param t_seconds the seconds since 1970-01-01T00:00, not negative
+     * @return the formatted time, such as 2025-06-20T14:00
+     */
+    static std::string formatTimestamp(long long t_seconds) {
+        long long days = t_seconds / 86400;
+        long long minutes = t_seconds % 86400 / 60;
+
+        // Inverse of daysFromCivil
+        long long shifted = days + 719468;
+        long long era = shifted / 146097;
+        long long dayOfEra = shifted - era * 146097;
+        long long yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+        long long dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+        long long monthIndex = (5 * dayOfYear + 2) / 153;
+        long long day = dayOfYear - (153 * monthIndex + 2) / 5 + 1;
+        long long month = monthIndex < 10 ? monthIndex + 3 : monthIndex - 9;
+        long long year = yearOfEra + era * 400 + (month <= 2 ? 1 : 0);
+
+        char text[96];
+        std::snprintf(text, sizeof(text), "%04lld-%02lld-%02lldT%02lld:%02lld", year, month, day, minutes / 60, minutes % 60);
+        return text;
+    }
+
     /**
     * Prints a menu with numbered options.
     *
@@ -365,19 +615,70 @@ public:
     }
 
     /**
-     * Prints progress bar based on line count with delay so user can see progress.
+     * Checks if standard output is attached to a terminal.
+     *
+     * @return true if standard output is a terminal, false if it is redirected to a file or pipe
+     */
+    static bool isOutputTerminal() {
+    #ifdef _WIN32
+        return _isatty(_fileno(stdout)) != 0;
+    #else
+        return isatty(STDOUT_FILENO) != 0;
+    #endif
+    }
+
+    /**
+     * Gets the size of the terminal window.
+     *
+     * @param t_rows the number of rows, 24 if it cannot be determined
+     * @param t_columns the number of columns, 80 if it cannot be determined
+     */
+    static void getTerminalSize(int& t_rows, int& t_columns) {
+        t_rows = 24;
+        t_columns = 80;
+    #ifdef _WIN32
+        CONSOLE_SCREEN_BUFFER_INFO info;
+        if (GetConsoleScreenBufferInfo(GetStdHandle(STD_OUTPUT_HANDLE), &info)) {
+            t_rows = info.srWindow.Bottom - info.srWindow.Top + 1;
+            t_columns = info.srWindow.Right - info.srWindow.Left + 1;
+        }
+    #else
+        struct winsize size;
+        if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) == 0 && size.ws_row > 0 && size.ws_col > 0) {
+            t_rows = size.ws_row;
+            t_columns = size.ws_col;
+        }
+    #endif
+    }
+
+    /**
+     * Lets the console interpret ANSI escape sequences for cursor movement and colors.
+     * Linux and macOS terminals always do; Windows consoles need it switched on.
+     */
+    static void enableEscapeSequences() {
+    #ifdef _WIN32
+        HANDLE output = GetStdHandle(STD_OUTPUT_HANDLE);
+        DWORD mode = 0;
+        if (GetConsoleMode(output, &mode)) {
+            SetConsoleMode(output, mode | ENABLE_VIRTUAL_TERMINAL_PROCESSING);
+        }
+    #endif
+    }
+
+    /**
+     * Prints progress bar based on line count.
+     * Callers that update frequently should go through ProgressReporter, which rate limits redraws.
      *
      * @param t_lineCount the line count to print the progress bar for
      * @param t_currentLine the current line to print the progress bar for
      * @param t_width the width of the progress bar
      */
-    static void printProgressBar(int t_lineCount, int t_currentLine, int t_width = 40) {
-        if (t_lineCount <= 0) {
+    static void printProgressBar(size_t t_lineCount, size_t t_currentLine, int t_width = 40) {
+        if (t_lineCount == 0) {
             return;
         }
 
-        // Calculate and show progress with delay so user can see progress
-        std::this_thread::sleep_for(std::chrono::milliseconds(15));
+        // Calculate and show progress
         double progress = static_cast<double>(t_currentLine) / t_lineCount;
         std::cout << Utils::createProgressBar(t_width, progress) << " " << t_currentLine << " of " << t_lineCount << "\r";
         std::cout.flush();
@@ -385,200 +686,5735 @@ public:
 };
 
 /**
- * Database class that stores item counts and provides methods to search and display the data.
+ * Non-owning view of a sequence of characters.
+ * Lets item names be looked up straight from the input buffer without building a std::string.
  */
-class Database {
+class StringView {
+private:
+    const char* m_data = nullptr;
+    size_t m_length = 0;
+
 public:
-    class DatabaseError : public std::runtime_error {
-    public:
-        explicit DatabaseError(const std::string& message) : std::runtime_error(message) {}
-    };
+    StringView() = default;
+    StringView(const char* t_data, size_t t_length) : m_data(t_data), m_length(t_length) {}
+    StringView(const std::string& t_str) : m_data(t_str.data()), m_length(t_str.length()) {}
+    StringView(const char* t_str) : m_data(t_str), m_length(std::strlen(t_str)) {}
 
-private:
-    std::map<std::string, int> m_itemCounts;
-    int m_maxItemCount = 0;
+    const char* data() const {
+        return m_data;
+    }
+
+    size_t size() const {
+        return m_length;
+    }
+
+    bool empty() const {
+        return m_length == 0;
+    }
 
     /**
-     * Gets the line count of a file.
+     * Copies the view into a string.
      *
-     * @param t_inputFileStream the file stream to get the line count of
-     * @return the line count of the file
+     * @return the viewed characters as a string
      */
-    int getLineCount(std::ifstream& t_inputFileStream) {
-        int lineCount = 0;
-        std::string line;
-        while (std::getline(t_inputFileStream, line)) {
-            if (line.empty()) {
-                continue;
-            }
-            lineCount++;
-        }
+    std::string str() const {
+        return std::string(m_data, m_length);
+    }
 
-        // Reset the file pointer to the beginning
-        t_inputFileStream.clear();
-        t_inputFileStream.seekg(0, std::ios::beg);
+    bool operator==(const StringView& t_other) const {
+        return m_length == t_other.m_length && (m_length == 0 || std::memcmp(m_data, t_other.m_data, m_length) == 0);
+    }
 
-        return lineCount;
+    bool operator!=(const StringView& t_other) const {
+        return !(*this == t_other);
     }
 
-public:
     /**
-     * Builds the database from the input file.
-     *
-     * @throws DatabaseError if the database cannot be built
+     * Orders views byte by byte, matching std::string comparison.
      */
-    void buildDatabaseFromFile(const std::string& t_inputFileName) {
-        Utils::setConsoleTextColor("blue");
-
-        // Open the input file
-        std::ifstream inputFile;
-        if (!Utils::tryOpenInputFile(t_inputFileName, inputFile)) {
-            throw DatabaseError("Failed to open input file: " + t_inputFileName);
-        }
+    bool operator<(const StringView& t_other) const {
+        size_t common = std::min(m_length, t_other.m_length);
+        int result = common == 0 ? 0 : std::memcmp(m_data, t_other.m_data, common);
+        return result < 0 || (result == 0 && m_length < t_other.m_length);
+    }
+};
 
-        int lineCount = getLineCount(inputFile);
+/**
+ * Rate limited progress bar for long running loops.
+ * The bar is only redrawn when progress crosses the next percentage step and the
+ * redraw interval has elapsed, so update() is cheap enough to call on every item.
+ * Nothing is drawn when standard output is not a terminal.
+ */
+class ProgressReporter {
+private:
+    size_t m_total;
+    size_t m_step;
+    size_t m_nextThreshold;
+    int m_width;
+    bool m_enabled;
+    bool m_finished = false;
+    std::chrono::milliseconds m_interval;
+    std::chrono::steady_clock::time_point m_lastDraw;
 
-        // Check if the file is empty
-        if (lineCount == 0) {
-            throw DatabaseError("Input file is empty");
-        }
+    /**
+     * Draws the bar and schedules the next threshold.
+     *
+     * @param t_current the current progress
+     */
+    void draw(size_t t_current) {
+        Utils::printProgressBar(m_total, t_current, m_width);
+        m_lastDraw = std::chrono::steady_clock::now();
+    }
 
-        // Process the file line by line and store the item counts and show progress
-        std::cout << "Reading input file" << " (" << lineCount << " lines)" << std::endl;
-        std::string item;
-        int currentLine = 0;
-        while (inputFile >> item) {
-            item = Utils::trim(item);
-            if (item.empty()) {
-                continue;
-            }
+public:
+    /**
+     * Creates a progress reporter.
+     *
+     * @param t_total the value that represents 100% progress
+     * @param t_visible false to draw nothing (optional, default is true)
+     * @param t_width the width of the progress bar
+     * @param t_interval the minimum time between redraws
+     */
+    explicit ProgressReporter(size_t t_total, bool t_visible = true, int t_width = 40, std::chrono::milliseconds t_interval = std::chrono::milliseconds(100))
+        : m_total(t_total), m_step(t_total / 100 > 0 ? t_total / 100 : 1), m_nextThreshold(0), m_width(t_width),
+          m_enabled(t_visible && t_total > 0 && Utils::isOutputTerminal()), m_interval(t_interval),
+          m_lastDraw(std::chrono::steady_clock::now() - t_interval) {}
 
-            // Update the item count
-            m_itemCounts[item]++;
-            if (m_itemCounts[item] > m_maxItemCount) {
-                m_maxItemCount = m_itemCounts[item];
-            }
+    ~ProgressReporter() {
+        finish();
+    }
 
-            currentLine++;
-            Utils::printProgressBar(lineCount, currentLine);
+    /**
+     * Reports progress, redrawing the bar only when a threshold is crossed.
+     *
+     * @param t_current the current progress, 0 through the total
+     */
+    void update(size_t t_current) {
+        if (!m_enabled || t_current < m_nextThreshold) {
+            return;
+        }
+        m_nextThreshold = t_current + m_step;
+        if (std::chrono::steady_clock::now() - m_lastDraw >= m_interval) {
+            draw(t_current);
         }
-        std::cout << std::endl;
-        inputFile.close();
     }
 
     /**
-     * Write database backup to file.
-     * 
-     * @throws DatabaseError if the database cannot be written
+     * Draws the completed bar and ends the line.
      */
-    void writeDatabaseBackup(const std::string& t_outputFileName) {
-        Utils::setConsoleTextColor("yellow");
-
-        // Open the output file
-        std::ofstream outputFile;
-        if (!Utils::tryOpenOutputFile(t_outputFileName, outputFile)) {
-            throw DatabaseError("Failed to open output file: " + t_outputFileName);
+    void finish() {
+        if (!m_enabled || m_finished) {
+            return;
         }
+        m_finished = true;
+        draw(m_total);
+        std::cout << std::endl;
+    }
+};
 
-        // Write the database to the output file line by line and show progress
-        std::cout << "Writing database backup" << " (" << m_itemCounts.size() << " lines)" << std::endl;
-        int currentLine = 0;
-        int lineCount = m_itemCounts.size();
-        for (const auto& item : m_itemCounts) {
-            outputFile << item.first << " " << item.second << std::endl;
+/**
+ * Output buffer that collects records in memory and hands them to the C stream in large writes.
+ * It can write to an already open stream such as stdout, or to a file that is written
+ * under a temporary name and renamed over the target on commit() so readers never see
+ * a half written file. Console colors are tracked so that repeated requests for the
+ * same color emit nothing.
+ */
+class BufferedWriter {
+private:
+    static const size_t BUFFER_SIZE = 1 << 20;
+    static std::atomic<unsigned int> s_tempFileCount;
+    std::string m_buffer;
+    std::FILE* m_stream = nullptr;
+    bool m_ownsStream = false;
+    bool m_failed = false;
+    std::string m_fileName;
+    std::string m_tempFileName;
+    ConsoleColor m_color = COLOR_COUNT;
 
-            currentLine++;
-            Utils::printProgressBar(lineCount, currentLine);
-        }
-        std::cout << std::endl;
-        outputFile.close();
+public:
+    /**
+     * Creates a writer with no destination; call open() before writing.
+     */
+    BufferedWriter() {
+        m_buffer.reserve(BUFFER_SIZE);
     }
 
     /**
-     * Tries to get the count of an item.
+     * Creates a writer for an already open stream.
      *
-     * @param t_item the item to get the count of
-     * @param t_count the count of the item
-     * @return true if the count was found, false otherwise
+     * @param t_stream the stream to write to, not closed by the writer
      */
-    bool tryGetItemCount(const std::string& t_item, int& t_count) {
-        // Trim and validate the item
-        std::string item = Utils::trim(t_item);
-        if (item.empty()) {
-            return false;
-        }
+    explicit BufferedWriter(std::FILE* t_stream) : m_stream(t_stream) {
+        m_buffer.reserve(BUFFER_SIZE);
+    }
 
-        // Try to get the item with the key as entered (case-sensitive)
-        auto it = m_itemCounts.find(item);
-        if (it != m_itemCounts.end()) {
-            t_count = it->second;
-            return true;
-        } else {
-            // Try capitalizing the first letter of the item (peas -> Peas) (case-insensitive)
-            item[0] = std::toupper(item[0]);
+    BufferedWriter(const BufferedWriter&) = delete;
+    BufferedWriter& operator=(const BufferedWriter&) = delete;
 
-            // Also make the rest of the item lowercase (PEAS -> Peas)
-            // Fixes issue #1: "Item not found" when searching for APPLES
-            for (size_t i = 1; i < item.length(); i++) {
-                item[i] = std::tolower(item[i]);
-            }
-            it = m_itemCounts.find(item);
-            if (it != m_itemCounts.end()) {
-                t_count = it->second;
-                return true;
-            }
+    ~BufferedWriter() {
+        if (m_ownsStream) {
+            // Abandoned without commit(), leave the target untouched
+            std::fclose(m_stream);
+            std::remove(m_tempFileName.c_str());
+        } else {
+            flush();
         }
-        return false;
     }
 
     /**
-     * Gets the item counts.
+     * Opens a file for writing under a temporary name next to it. The name holds the
+     * process id and a per process count, so two writers never share a temporary file.
      *
-     * @return the item counts
+     * @param t_fileName the name of the file that commit() will replace
+     * @return true if the temporary file was created, false otherwise
      */
-    std::map<std::string, int> getItemCounts() {
-        return m_itemCounts;
+    bool open(const std::string& t_fileName) {
+    #ifdef _WIN32
+        unsigned long processId = GetCurrentProcessId();
+    #else
+        unsigned long processId = static_cast<unsigned long>(getpid());
+    #endif
+        m_fileName = t_fileName;
+        m_tempFileName = t_fileName + "." + std::to_string(processId) + "." + std::to_string(s_tempFileCount++) + ".tmp";
+        m_stream = std::fopen(m_tempFileName.c_str(), "wb");
+        m_ownsStream = m_stream != nullptr;
+        m_failed = false;
+        return m_ownsStream;
     }
 
     /**
-     * Gets the max item count.
+     * Appends characters to the buffer.
      *
-     * @return the max item count
+     * @param t_str the characters to append
      */
-    int getMaxItemCount() {
-        return m_maxItemCount;
+    void write(StringView t_str) {
+        if (m_buffer.size() + t_str.size() > BUFFER_SIZE) {
+            flush();
+        }
+        m_buffer.append(t_str.data(), t_str.size());
     }
-};
 
-/**
- * Inventory Analyzer class serves as the program controller.
- */
-class InventoryAnalyzer {
-private:
-    std::string m_inputFileName = "CS210_Project_Three_Input_File.txt";
-    std::string m_outputFileName = "frequency.dat";
-    int m_displayWidth = 80;
-    std::string m_uiColor = "cyan";
-    Database m_database;
-    std::vector<std::string> m_mainMenuOptions = {
-        "Search for Item by Name",
-        "Display Count of All Items (Numerical)",
-        "Display Count of All Items (Histogram)",
-        "Exit"
-    };
-    // define histogram colors as heatmap
-    std::vector<std::string> m_heatMapColors = {
-        "red",
-        "yellow",
-        "green",
-        "blue",
-    };
+    /**
+     * Appends a character to the buffer.
+     *
+     * @param t_char the character to append
+     */
+    void write(char t_char) {
+        if (m_buffer.size() >= BUFFER_SIZE) {
+            flush();
+        }
+        m_buffer.push_back(t_char);
+    }
 
     /**
-     * Prints ASCII Art Logo Part 1
+     * Appends the decimal form of a number to the buffer without a temporary string.
+     *
+     * @param t_number the number to append
      */
-     void printLogoPart1() {
-        std::cout << "    ░░░░░░░░░░░                                                                 " << std::endl;
+    void writeNumber(long long t_number) {
+        char digits[24];
+        char* cursor = digits + sizeof(digits);
+        unsigned long long magnitude = t_number < 0 ? 0ULL - static_cast<unsigned long long>(t_number) : static_cast<unsigned long long>(t_number);
+        do {
+            *--cursor = static_cast<char>('0' + magnitude % 10);
+            magnitude /= 10;
+        } while (magnitude > 0);
+        if (t_number < 0) {
+            *--cursor = '-';
+        }
+        write(StringView(cursor, digits + sizeof(digits) - cursor));
+    }
+
+    /**
+     * Sets the console text color, emitting nothing if the color is already set.
+     *
+     * @param t_color the color to set
+     */
+    void setColor(ConsoleColor t_color) {
+        if (t_color == m_color) {
+            return;
+        }
+        m_color = t_color;
+    #ifdef _WIN32
+        // The Windows console color is a handle attribute, so pending text must go out first
+        flush();
+        Utils::setConsoleTextColor(t_color);
+    #else
+        write(Utils::getConsoleColorCode(t_color));
+    #endif
+    }
+
+    /**
+     * Writes the buffered characters to the stream.
+     */
+    void flush() {
+        if (m_stream == nullptr) {
+            return;
+        }
+        if (!m_buffer.empty() && std::fwrite(m_buffer.data(), 1, m_buffer.size(), m_stream) != m_buffer.size()) {
+            m_failed = true;
+        }
+        m_buffer.clear();
+        if (std::fflush(m_stream) != 0) {
+            m_failed = true;
+        }
+    }
+
+    /**
+     * Finishes a file opened with open() and atomically moves it over the target.
+     *
+     * @return true if every write succeeded and the file was replaced, false otherwise
+     */
+    bool commit() {
+        if (!m_ownsStream) {
+            return false;
+        }
+        flush();
+        m_ownsStream = false;
+        if (std::fclose(m_stream) != 0) {
+            m_failed = true;
+        }
+        m_stream = nullptr;
+        if (!m_failed) {
+        #ifdef _WIN32
+            m_failed = !MoveFileExA(m_tempFileName.c_str(), m_fileName.c_str(), MOVEFILE_REPLACE_EXISTING);
+        #else
+            m_failed = std::rename(m_tempFileName.c_str(), m_fileName.c_str()) != 0;
+        #endif
+        }
+        if (m_failed) {
+            std::remove(m_tempFileName.c_str());
+        }
+        return !m_failed;
+    }
+};
+
+std::atomic<unsigned int> BufferedWriter::s_tempFileCount(0);
+
+/**
+ * Timings and counters for the --stats report.
+ * Phases are timed with ScopedTimer into histograms of log2 microsecond buckets, and
+ * ingest throughput is derived from the bytes and items the database reports against the
+ * time of the "ingest" phase. Nothing is recorded until enable(), so a disabled timer costs
+ * one branch. Phases must be recorded from the main thread; the allocation counters are
+ * atomic and count every thread from program start.
+ */
+class Instrumentation {
+public:
+    static const size_t BUCKET_COUNT = 40;  // bucket i holds durations under 2^i microseconds
+
+private:
+    struct Phase {
+        const char* name;
+        size_t calls;
+        uint64_t totalNanos;
+        uint64_t maxNanos;
+        size_t buckets[BUCKET_COUNT];
+    };
+
+    static bool s_enabled;
+    static std::atomic<size_t> s_allocationCount;
+    static std::atomic<size_t> s_allocatedBytes;
+    static uint64_t s_ingestedBytes;
+    static uint64_t s_ingestedItems;
+
+    static std::vector<Phase>& phases() {
+        static std::vector<Phase> s_phases;
+        return s_phases;
+    }
+
+    static Phase& findPhase(const char* t_name) {
+        std::vector<Phase>& allPhases = phases();
+        for (Phase& phase : allPhases) {
+            if (phase.name == t_name || std::strcmp(phase.name, t_name) == 0) {
+                return phase;
+            }
+        }
+        Phase phase = Phase();
+        phase.name = t_name;
+        allPhases.push_back(phase);
+        return allPhases.back();
+    }
+
+    /**
+     * Gets the upper bound of the bucket that holds a share of a phase's calls.
+     *
+     * @param t_phase the phase
+     * @param t_share the share of calls, 0.5 for the median
+     * @return the bucket bound in microseconds
+     */
+    static uint64_t percentileMicros(const Phase& t_phase, double t_share) {
+        size_t wanted = static_cast<size_t>(std::ceil(t_phase.calls * t_share));
+        size_t seen = 0;
+        for (size_t i = 0; i < BUCKET_COUNT; i++) {
+            seen += t_phase.buckets[i];
+            if (seen >= wanted && seen > 0) {
+                return static_cast<uint64_t>(1) << i;
+            }
+        }
+        return static_cast<uint64_t>(1) << (BUCKET_COUNT - 1);
+    }
+
+    static double ingestSeconds() {
+        for (const Phase& phase : phases()) {
+            if (std::strcmp(phase.name, "ingest") == 0) {
+                return phase.totalNanos / 1e9;
+            }
+        }
+        return 0;
+    }
+
+public:
+    /**
+     * Starts recording phases and ingest totals.
+     */
+    static void enable() {
+        s_enabled = true;
+    }
+
+    /**
+     * Checks if recording is on.
+     *
+     * @return true after enable()
+     */
+    static bool isEnabled() {
+        return s_enabled;
+    }
+
+    /**
+     * Adds one timed call to a phase.
+     *
+     * @param t_name the phase name, a string literal
+     * @param t_nanos the duration of the call in nanoseconds
+     */
+    static void recordDuration(const char* t_name, uint64_t t_nanos) {
+        Phase& phase = findPhase(t_name);
+        phase.calls++;
+        phase.totalNanos += t_nanos;
+        phase.maxNanos = std::max(phase.maxNanos, t_nanos);
+        uint64_t micros = t_nanos / 1000;
+        size_t bucket = 0;
+        while (bucket + 1 < BUCKET_COUNT && (micros >> bucket) != 0) {
+            bucket++;
+        }
+        phase.buckets[bucket]++;
+    }
+
+    /**
+     * Counts one heap allocation. Called by the global operator new, so without
+     * --stats it only reads the flag, which is set before any worker thread starts.
+     *
+     * @param t_size the size of the allocation in bytes
+     */
+    static void countAllocation(size_t t_size) {
+        if (s_enabled) {
+            s_allocationCount.fetch_add(1, std::memory_order_relaxed);
+            s_allocatedBytes.fetch_add(t_size, std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * Adds to the bytes read by ingest.
+     *
+     * @param t_bytes the number of input bytes scanned
+     */
+    static void addIngestedBytes(uint64_t t_bytes) {
+        if (s_enabled) {
+            s_ingestedBytes += t_bytes;
+        }
+    }
+
+    /**
+     * Adds to the items counted by ingest.
+     *
+     * @param t_items the number of item sightings counted
+     */
+    static void addIngestedItems(uint64_t t_items) {
+        if (s_enabled) {
+            s_ingestedItems += t_items;
+        }
+    }
+
+    /**
+     * Gets the largest resident set size the process has reached.
+     *
+     * @return the peak memory in kilobytes, -1 where it cannot be read
+     */
+    static long long getPeakMemoryKilobytes() {
+    #ifdef _WIN32
+        return -1;
+    #else
+        struct rusage usage;
+        if (getrusage(RUSAGE_SELF, &usage) != 0) {
+            return -1;
+        }
+    #ifdef __APPLE__
+        return static_cast<long long>(usage.ru_maxrss) / 1024;
+    #else
+        return static_cast<long long>(usage.ru_maxrss);
+    #endif
+    #endif
+    }
+
+    /**
+     * Writes the report as a table for people.
+     *
+     * @param t_output the stream to write to
+     */
+    static void writeReport(std::ostream& t_output) {
+        char line[160];
+        double seconds = ingestSeconds();
+        t_output << std::endl << "Performance statistics" << std::endl;
+        if (s_ingestedBytes > 0 && seconds > 0) {
+            std::snprintf(line, sizeof(line), "  Ingest       %.2f MB, %llu items in %.3f s: %.1f MB/s, %.0f items/s",
+                          s_ingestedBytes / 1e6, static_cast<unsigned long long>(s_ingestedItems), seconds,
+                          s_ingestedBytes / 1e6 / seconds, s_ingestedItems / seconds);
+            t_output << line << std::endl;
+        }
+        long long peakMemory = getPeakMemoryKilobytes();
+        if (peakMemory >= 0) {
+            t_output << "  Peak memory  " << peakMemory << " KB" << std::endl;
+        }
+        t_output << "  Allocations  " << s_allocationCount.load() << " (" << s_allocatedBytes.load() << " bytes)" << std::endl << std::endl;
+
+        // Percentiles are bucket bounds, so they read as "at most"
+        std::snprintf(line, sizeof(line), "  %-20s %8s %12s %12s %10s %10s %12s", "Phase", "Calls", "Total ms", "Mean us", "p50 us <=", "p99 us <=", "Max us");
+        t_output << line << std::endl;
+        for (const Phase& phase : phases()) {
+            std::snprintf(line, sizeof(line), "  %-20s %8llu %12.3f %12.1f %10llu %10llu %12.1f", phase.name,
+                          static_cast<unsigned long long>(phase.calls), phase.totalNanos / 1e6, phase.totalNanos / 1e3 / phase.calls,
+                          static_cast<unsigned long long>(percentileMicros(phase, 0.5)), static_cast<unsigned long long>(percentileMicros(phase, 0.99)),
+                          phase.maxNanos / 1e3);
+            t_output << line << std::endl;
+        }
+    }
+
+    /**
+     * Saves the report as JSON, with each phase's full histogram keyed by bucket bound in microseconds.
+     *
+     * @param t_fileName the name of the file to write
+     * @return true if the file was written, false otherwise
+     */
+    static bool writeJson(const std::string& t_fileName) {
+        BufferedWriter output;
+        if (!output.open(t_fileName)) {
+            return false;
+        }
+        char number[64];
+        double seconds = ingestSeconds();
+        output.write("{\n  \"ingest\": {\"bytes\": ");
+        output.writeNumber(static_cast<long long>(s_ingestedBytes));
+        output.write(", \"items\": ");
+        output.writeNumber(static_cast<long long>(s_ingestedItems));
+        std::snprintf(number, sizeof(number), ", \"seconds\": %.6f", seconds);
+        output.write(number);
+        std::snprintf(number, sizeof(number), ", \"mb_per_second\": %.3f", seconds > 0 ? s_ingestedBytes / 1e6 / seconds : 0.0);
+        output.write(number);
+        std::snprintf(number, sizeof(number), ", \"items_per_second\": %.1f},\n", seconds > 0 ? s_ingestedItems / seconds : 0.0);
+        output.write(number);
+        output.write("  \"peak_memory_kb\": ");
+        output.writeNumber(getPeakMemoryKilobytes());
+        output.write(",\n  \"allocations\": ");
+        output.writeNumber(static_cast<long long>(s_allocationCount.load()));
+        output.write(",\n  \"allocated_bytes\": ");
+        output.writeNumber(static_cast<long long>(s_allocatedBytes.load()));
+        output.write(",\n  \"phases\": [");
+        for (size_t i = 0; i < phases().size(); i++) {
+            const Phase& phase = phases()[i];
+            output.write(i == 0 ? "\n    {\"name\": \"" : ",\n    {\"name\": \"");
+            output.write(phase.name);
+            output.write("\", \"calls\": ");
+            output.writeNumber(static_cast<long long>(phase.calls));
+            output.write(", \"total_ns\": ");
+            output.writeNumber(static_cast<long long>(phase.totalNanos));
+            output.write(", \"max_ns\": ");
+            output.writeNumber(static_cast<long long>(phase.maxNanos));
+            output.write(", \"histogram_us\": {");
+            bool first = true;
+            for (size_t bucket = 0; bucket < BUCKET_COUNT; bucket++) {
+                if (phase.buckets[bucket] == 0) {
+                    continue;
+                }
+                output.write(first ? "\"" : ", \"");
+                output.writeNumber(1LL << bucket);
+                output.write("\": ");
+                output.writeNumber(static_cast<long long>(phase.buckets[bucket]));
+                first = false;
+            }
+            output.write("}}");
+        }
+        output.write("\n  ]\n}\n");
+        return output.commit();
+    }
+};
+
+bool Instrumentation::s_enabled = false;
+std::atomic<size_t> Instrumentation::s_allocationCount(0);
+std::atomic<size_t> Instrumentation::s_allocatedBytes(0);
+uint64_t Instrumentation::s_ingestedBytes = 0;
+uint64_t Instrumentation::s_ingestedItems = 0;
+
+// Every heap allocation is counted for the --stats report. The replacements stay out of line
+// so optimizers do not pair an inlined free() with a new expression and warn about a mismatch.
+#if defined(__GNUC__) || defined(__clang__)
+#define INSTRUMENTATION_NOINLINE __attribute__((noinline))
+#elif defined(_MSC_VER)
+#define INSTRUMENTATION_NOINLINE __declspec(noinline)
+#else
+#define INSTRUMENTATION_NOINLINE
+#endif
+
+INSTRUMENTATION_NOINLINE void* operator new(std::size_t t_size) {
+    Instrumentation::countAllocation(t_size);
+    while (true) {
+        void* memory = std::malloc(t_size == 0 ? 1 : t_size);
+        if (memory != nullptr) {
+            return memory;
+        }
+        std::new_handler handler = std::get_new_handler();
+        if (handler == nullptr) {
+            throw std::bad_alloc();
+        }
+        handler();
+    }
+}
+
+INSTRUMENTATION_NOINLINE void operator delete(void* t_memory) noexcept {
+    std::free(t_memory);
+}
+
+/**
+ * Times the enclosing scope as one call of an Instrumentation phase.
+ * Only reads the clock when instrumentation is enabled.
+ */
+class ScopedTimer {
+private:
+    const char* m_name;
+    bool m_active;
+    std::chrono::steady_clock::time_point m_start;
+
+public:
+    /**
+     * Starts timing.
+     *
+     * @param t_name the phase name, a string literal
+     */
+    explicit ScopedTimer(const char* t_name) : m_name(t_name), m_active(Instrumentation::isEnabled()) {
+        if (m_active) {
+            m_start = std::chrono::steady_clock::now();
+        }
+    }
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+    ~ScopedTimer() {
+        if (m_active) {
+            auto elapsed = std::chrono::steady_clock::now() - m_start;
+            Instrumentation::recordDuration(m_name, static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+        }
+    }
+};
+
+/**
+ * Read-only memory mapping of a file.
+ * The mapping is released when the object is destroyed.
+ */
+class MappedFile {
+private:
+    const char* m_data = nullptr;
+    size_t m_size = 0;
+#ifdef _WIN32
+    HANDLE m_file = INVALID_HANDLE_VALUE;
+    HANDLE m_mapping = nullptr;
+#endif
+
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile() {
+        close();
+    }
+
+    /**
+     * Maps a file into memory for reading.
+     * An empty file opens successfully with no data mapped.
+     *
+     * @param t_fileName the name of the file to map
+     * @return true if the file was mapped successfully, false otherwise
+     */
+    bool open(const std::string& t_fileName) {
+        close();
+    #ifdef _WIN32
+        m_file = CreateFileA(t_fileName.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (m_file == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(m_file, &fileSize)) {
+            close();
+            return false;
+        }
+        m_size = static_cast<size_t>(fileSize.QuadPart);
+        if (m_size == 0) {
+            return true;
+        }
+        m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (m_mapping == nullptr) {
+            close();
+            return false;
+        }
+        m_data = static_cast<const char*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+        if (m_data == nullptr) {
+            close();
+            return false;
+        }
+    #else
+        int fd = ::open(t_fileName.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat fileInfo;
+        if (fstat(fd, &fileInfo) != 0 || !S_ISREG(fileInfo.st_mode)) {
+            ::close(fd);
+            return false;
+        }
+        m_size = static_cast<size_t>(fileInfo.st_size);
+        if (m_size > 0) {
+            void* data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data == MAP_FAILED) {
+                ::close(fd);
+                m_size = 0;
+                return false;
+            }
+            // The file is scanned front to back exactly once
+            madvise(data, m_size, MADV_SEQUENTIAL);
+            m_data = static_cast<const char*>(data);
+        }
+        // The mapping stays valid after the descriptor is closed
+        ::close(fd);
+    #endif
+        return true;
+    }
+
+    /**
+     * Releases the mapping.
+     */
+    void close() {
+    #ifdef _WIN32
+        if (m_data != nullptr) {
+            UnmapViewOfFile(m_data);
+        }
+        if (m_mapping != nullptr) {
+            CloseHandle(m_mapping);
+        }
+        if (m_file != INVALID_HANDLE_VALUE) {
+            CloseHandle(m_file);
+        }
+        m_mapping = nullptr;
+        m_file = INVALID_HANDLE_VALUE;
+    #else
+        if (m_data != nullptr) {
+            munmap(const_cast<char*>(m_data), m_size);
+        }
+    #endif
+        m_data = nullptr;
+        m_size = 0;
+    }
+
+    /**
+     * Gets the mapped data.
+     *
+     * @return pointer to the first byte of the file, nullptr if the file is empty
+     */
+    const char* data() const {
+        return m_data;
+    }
+
+    /**
+     * Gets the size of the mapped file.
+     *
+     * @return the size of the file in bytes
+     */
+    size_t size() const {
+        return m_size;
+    }
+};
+
+/**
+ * Waits for a file to change.
+ * On Linux the file is watched with inotify so an idle file costs nothing; other
+ * platforms, and files inotify cannot watch, fall back to comparing the size and
+ * modification time each time the wait times out.
+ */
+class FileWatcher {
+private:
+    std::string m_fileName;
+    long long m_lastSize = -1;
+    long long m_lastModified = -1;
+#ifdef __linux__
+    int m_inotifyFd = -1;
+    int m_watchFd = -1;
+
+    /**
+     * Starts watching the file, which also picks up a file that was replaced by rotation.
+     */
+    void addWatch() {
+        if (m_watchFd >= 0) {
+            inotify_rm_watch(m_inotifyFd, m_watchFd);
+        }
+        m_watchFd = inotify_add_watch(m_inotifyFd, m_fileName.c_str(), IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB | IN_MOVE_SELF | IN_DELETE_SELF);
+    }
+#endif
+
+    /**
+     * Checks the size and modification time for a change since the last check.
+     *
+     * @return true if either changed, false otherwise
+     */
+    bool pollForChange() {
+        long long size = -1;
+        long long modified = -1;
+    #ifdef _WIN32
+        WIN32_FILE_ATTRIBUTE_DATA info;
+        if (GetFileAttributesExA(m_fileName.c_str(), GetFileExInfoStandard, &info)) {
+            size = (static_cast<long long>(info.nFileSizeHigh) << 32) | info.nFileSizeLow;
+            modified = (static_cast<long long>(info.ftLastWriteTime.dwHighDateTime) << 32) | info.ftLastWriteTime.dwLowDateTime;
+        }
+    #else
+        struct stat fileInfo;
+        if (stat(m_fileName.c_str(), &fileInfo) == 0) {
+            size = static_cast<long long>(fileInfo.st_size);
+            modified = static_cast<long long>(fileInfo.st_mtime);
+        }
+    #endif
+        bool changed = size != m_lastSize || modified != m_lastModified;
+        m_lastSize = size;
+        m_lastModified = modified;
+        return changed;
+    }
+
+public:
+    FileWatcher() = default;
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+
+    ~FileWatcher() {
+    #ifdef __linux__
+        if (m_inotifyFd >= 0) {
+            ::close(m_inotifyFd);
+        }
+    #endif
+    }
+
+    /**
+     * Starts watching a file.
+     *
+     * @param t_fileName the name of the file to watch
+     */
+    void open(const std::string& t_fileName) {
+        m_fileName = t_fileName;
+        pollForChange();
+    #ifdef __linux__
+        m_inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (m_inotifyFd >= 0) {
+            addWatch();
+        }
+    #endif
+    }
+
+    /**
+     * Waits until the file changes or the timeout passes.
+     *
+     * @param t_timeout the longest time to wait
+     * @return true if the file changed, false if the timeout passed first
+     */
+    bool waitForChange(std::chrono::milliseconds t_timeout) {
+    #ifdef __linux__
+        if (m_inotifyFd >= 0 && m_watchFd >= 0) {
+            struct pollfd pollInfo;
+            pollInfo.fd = m_inotifyFd;
+            pollInfo.events = POLLIN;
+            if (poll(&pollInfo, 1, static_cast<int>(t_timeout.count())) <= 0) {
+                return false;
+            }
+
+            // Drain the events; a moved or deleted file is watched again under its name
+            alignas(struct inotify_event) char events[4096];
+            bool replaced = false;
+            long long length;
+            while ((length = read(m_inotifyFd, events, sizeof(events))) > 0) {
+                for (char* cursor = events; cursor < events + length;) {
+                    struct inotify_event* event = reinterpret_cast<struct inotify_event*>(cursor);
+                    replaced = replaced || (event->mask & (IN_MOVE_SELF | IN_DELETE_SELF | IN_IGNORED)) != 0;
+                    cursor += sizeof(struct inotify_event) + event->len;
+                }
+            }
+            if (replaced) {
+                addWatch();
+            }
+            pollForChange();
+            return true;
+        }
+        if (m_inotifyFd >= 0) {
+            // The file did not exist when the watch was added; try again
+            addWatch();
+        }
+    #endif
+        std::this_thread::sleep_for(t_timeout);
+        return pollForChange();
+    }
+};
+
+/**
+ * Reads single key presses from the console without echo or line buffering.
+ * The console mode is switched when the object is created and restored when it is destroyed.
+ * Ctrl+C is read as KEY_INTERRUPT instead of ending the process, so the caller can restore
+ * the screen before it returns.
+ */
+class Keyboard {
+private:
+#ifdef _WIN32
+    HANDLE m_input = nullptr;
+    DWORD m_savedMode = 0;
+#else
+    struct termios m_savedMode;
+#endif
+    bool m_active = false;
+
+public:
+    // Keys that do not produce a character; characters are returned as their byte value
+    static const int KEY_UP = 0x100;
+    static const int KEY_DOWN = 0x101;
+    static const int KEY_PAGE_UP = 0x102;
+    static const int KEY_PAGE_DOWN = 0x103;
+    static const int KEY_HOME = 0x104;
+    static const int KEY_END = 0x105;
+    static const int KEY_ESCAPE = 0x106;
+    static const int KEY_ENTER = 0x107;
+    static const int KEY_TAB = 0x108;
+    static const int KEY_INTERRUPT = 0x109;
+
+    /**
+     * Switches standard input to reading single keys if it is a terminal.
+     */
+    Keyboard() {
+    #ifdef _WIN32
+        m_input = GetStdHandle(STD_INPUT_HANDLE);
+        if (_isatty(_fileno(stdin)) && GetConsoleMode(m_input, &m_savedMode)) {
+            SetConsoleMode(m_input, m_savedMode & ~(ENABLE_LINE_INPUT | ENABLE_ECHO_INPUT | ENABLE_PROCESSED_INPUT));
+            m_active = true;
+        }
+    #else
+        if (isatty(STDIN_FILENO) && tcgetattr(STDIN_FILENO, &m_savedMode) == 0) {
+            struct termios raw = m_savedMode;
+            raw.c_lflag &= ~(ICANON | ECHO | ISIG);
+            raw.c_cc[VMIN] = 1;
+            raw.c_cc[VTIME] = 0;
+            m_active = tcsetattr(STDIN_FILENO, TCSANOW, &raw) == 0;
+        }
+    #endif
+    }
+
+    Keyboard(const Keyboard&) = delete;
+    Keyboard& operator=(const Keyboard&) = delete;
+
+    ~Keyboard() {
+        if (!m_active) {
+            return;
+        }
+    #ifdef _WIN32
+        SetConsoleMode(m_input, m_savedMode);
+    #else
+        tcsetattr(STDIN_FILENO, TCSANOW, &m_savedMode);
+    #endif
+    }
+
+    /**
+     * Checks if single keys can be read, which needs standard input to be a terminal.
+     *
+     * @return true if the console mode was switched, false otherwise
+     */
+    bool isActive() const {
+        return m_active;
+    }
+
+    /**
+     * Waits for the next key press.
+     *
+     * @return the byte value of a character, one of the KEY_ constants, or -1 at end of input
+     */
+    int read() {
+    #ifdef _WIN32
+        int key = _getch();
+        if (key == 0 || key == 0xE0) {
+            switch (_getch()) {
+                case 72: return KEY_UP;
+                case 80: return KEY_DOWN;
+                case 73: return KEY_PAGE_UP;
+                case 81: return KEY_PAGE_DOWN;
+                case 71: return KEY_HOME;
+                case 79: return KEY_END;
+                default: return read();
+            }
+        }
+    #else
+        int key = readByte();
+        if (key == 0x1B) {
+            // A lone escape is the Escape key; otherwise it starts a CSI or SS3 sequence
+            if (!isByteReady()) {
+                return KEY_ESCAPE;
+            }
+            int introducer = readByte();
+            if (introducer != '[' && introducer != 'O') {
+                return KEY_ESCAPE;
+            }
+            int code = readByte();
+            int parameter = 0;
+            while (code >= '0' && code <= '9') {
+                parameter = parameter * 10 + (code - '0');
+                code = readByte();
+            }
+            switch (code) {
+                case 'A': return KEY_UP;
+                case 'B': return KEY_DOWN;
+                case 'H': return KEY_HOME;
+                case 'F': return KEY_END;
+                case '~':
+                    switch (parameter) {
+                        case 1: case 7: return KEY_HOME;
+                        case 4: case 8: return KEY_END;
+                        case 5: return KEY_PAGE_UP;
+                        case 6: return KEY_PAGE_DOWN;
+                        default: return read();
+                    }
+                default: return read();
+            }
+        }
+    #endif
+        if (key == '\r' || key == '\n') {
+            return KEY_ENTER;
+        }
+        if (key == '\t') {
+            return KEY_TAB;
+        }
+        if (key == 0x03) {
+            return KEY_INTERRUPT;
+        }
+        if (key == 0x1B) {
+            return KEY_ESCAPE;
+        }
+        return key;
+    }
+
+private:
+#ifndef _WIN32
+    /**
+     * Reads one byte of standard input.
+     *
+     * @return the byte, or -1 at end of input
+     */
+    static int readByte() {
+        unsigned char byte;
+        return ::read(STDIN_FILENO, &byte, 1) == 1 ? byte : -1;
+    }
+
+    /**
+     * Checks if another byte arrives shortly, telling escape sequences from the Escape key.
+     *
+     * @return true if a byte can be read without waiting, false otherwise
+     */
+    static bool isByteReady() {
+        struct pollfd input = {STDIN_FILENO, POLLIN, 0};
+        return poll(&input, 1, 50) > 0;
+    }
+#endif
+};
+
+/**
+ * Splits a range of bytes into whitespace separated tokens, 64 bytes at a time.
+ * Each block is classified into a bit mask with one bit per whitespace byte, using AVX2
+ * or SSE2 when the processor has it and a byte loop otherwise, and token boundaries are
+ * then read off the mask with bit scans. The instruction set is picked once at run time.
+ */
+class TokenScanner {
+public:
+    enum InstructionSet {
+        SCALAR,
+        SSE2,
+        AVX2
+    };
+
+private:
+    typedef uint64_t (*MaskFunction)(const char*);
+
+    /**
+     * Classifies 64 bytes with the same rules as Utils::isWhitespace().
+     *
+     * @param t_block the first of 64 readable bytes
+     * @return a mask with bit i set if byte i is whitespace
+     */
+    static uint64_t whitespaceMaskScalar(const char* t_block) {
+        uint64_t mask = 0;
+        for (int i = 0; i < 64; i++) {
+            mask |= static_cast<uint64_t>(Utils::isWhitespace(t_block[i])) << i;
+        }
+        return mask;
+    }
+
+#ifdef TOKEN_SCANNER_SIMD
+    /**
+     * Classifies 64 bytes 16 at a time. SSE2 is part of every x86-64 processor.
+     */
+    static uint64_t whitespaceMaskSse2(const char* t_block) {
+        const __m128i space = _mm_set1_epi8(' ');
+        const __m128i tab = _mm_set1_epi8('\t');
+        const __m128i controlSpan = _mm_set1_epi8('\r' - '\t');
+        uint64_t mask = 0;
+        for (int i = 0; i < 4; i++) {
+            __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(t_block + 16 * i));
+            // Tab to carriage return is one range; it is tested as an unsigned offset from tab
+            __m128i offset = _mm_sub_epi8(bytes, tab);
+            __m128i control = _mm_cmpeq_epi8(_mm_min_epu8(offset, controlSpan), offset);
+            __m128i whitespace = _mm_or_si128(_mm_cmpeq_epi8(bytes, space), control);
+            mask |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(whitespace))) << (16 * i);
+        }
+        return mask;
+    }
+
+    /**
+     * Classifies 64 bytes 32 at a time.
+     */
+    TOKEN_SCANNER_AVX2_TARGET
+    static uint64_t whitespaceMaskAvx2(const char* t_block) {
+        const __m256i space = _mm256_set1_epi8(' ');
+        const __m256i tab = _mm256_set1_epi8('\t');
+        const __m256i controlSpan = _mm256_set1_epi8('\r' - '\t');
+        uint64_t mask = 0;
+        for (int i = 0; i < 2; i++) {
+            __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(t_block + 32 * i));
+            __m256i offset = _mm256_sub_epi8(bytes, tab);
+            __m256i control = _mm256_cmpeq_epi8(_mm256_min_epu8(offset, controlSpan), offset);
+            __m256i whitespace = _mm256_or_si256(_mm256_cmpeq_epi8(bytes, space), control);
+            mask |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(whitespace))) << (32 * i);
+        }
+        return mask;
+    }
+#endif
+
+    /**
+     * Gets the classifier for an instruction set, falling back to the best one available.
+     *
+     * @param t_set the instruction set wanted
+     * @return the classifier
+     */
+    static MaskFunction getMaskFunction(InstructionSet t_set) {
+    #ifdef TOKEN_SCANNER_SIMD
+        if (t_set == AVX2 && isSupported(AVX2)) {
+            return whitespaceMaskAvx2;
+        }
+        if (t_set != SCALAR) {
+            return whitespaceMaskSse2;
+        }
+    #else
+        (void)t_set;
+    #endif
+        return whitespaceMaskScalar;
+    }
+
+    /**
+     * Gets the index of the lowest set bit.
+     *
+     * @param t_mask the mask, not 0
+     * @return the index of the lowest set bit
+     */
+    static unsigned lowestSetBit(uint64_t t_mask) {
+    #if defined(__GNUC__)
+        return static_cast<unsigned>(__builtin_ctzll(t_mask));
+    #elif defined(_MSC_VER) && defined(_M_X64)
+        unsigned long index;
+        _BitScanForward64(&index, t_mask);
+        return static_cast<unsigned>(index);
+    #else
+        unsigned index = 0;
+        while ((t_mask & 1) == 0) {
+            t_mask >>= 1;
+            index++;
+        }
+        return index;
+    #endif
+    }
+
+public:
+    /**
+     * Checks if the processor supports an instruction set.
+     *
+     * @param t_set the instruction set
+     * @return true if tokens can be scanned with it, false otherwise
+     */
+    static bool isSupported(InstructionSet t_set) {
+        if (t_set == SCALAR) {
+            return true;
+        }
+    #ifdef TOKEN_SCANNER_SIMD
+        if (t_set == SSE2) {
+            return true;
+        }
+    #if defined(__GNUC__)
+        return __builtin_cpu_supports("avx2") != 0;
+    #else
+        // AVX2 needs the processor flag and the operating system saving the AVX registers
+        int info[4];
+        __cpuid(info, 1);
+        bool osSavesAvx = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 && (_xgetbv(0) & 0x6) == 0x6;
+        __cpuidex(info, 7, 0);
+        return osSavesAvx && (info[1] & (1 << 5)) != 0;
+    #endif
+    #else
+        return false;
+    #endif
+    }
+
+    /**
+     * Gets the fastest instruction set the processor supports, worked out on the first call.
+     *
+     * @return the instruction set used by forEachToken()
+     */
+    static InstructionSet getBestInstructionSet() {
+        static const InstructionSet best = isSupported(AVX2) ? AVX2 : (isSupported(SSE2) ? SSE2 : SCALAR);
+        return best;
+    }
+
+    /**
+     * Gets the name of an instruction set.
+     *
+     * @param t_set the instruction set
+     * @return the name
+     */
+    static const char* getName(InstructionSet t_set) {
+        return t_set == AVX2 ? "avx2" : (t_set == SSE2 ? "sse2" : "scalar");
+    }
+
+    /**
+     * Calls a function with each whitespace separated token in a range of bytes, using the
+     * fastest instruction set the processor supports.
+     *
+     * @param t_begin the first byte of the range
+     * @param t_end one past the last byte of the range
+     * @param t_visitor called with the first byte and one past the last byte of each token
+     */
+    template <typename Visitor>
+    static void forEachToken(const char* t_begin, const char* t_end, Visitor t_visitor) {
+        static const MaskFunction bestMask = getMaskFunction(getBestInstructionSet());
+        scan(t_begin, t_end, t_visitor, bestMask);
+    }
+
+    /**
+     * Calls a function with each whitespace separated token in a range of bytes, using a
+     * given instruction set, or the best available one if it is not supported.
+     *
+     * @param t_begin the first byte of the range
+     * @param t_end one past the last byte of the range
+     * @param t_visitor called with the first byte and one past the last byte of each token
+     * @param t_set the instruction set to classify bytes with
+     */
+    template <typename Visitor>
+    static void forEachToken(const char* t_begin, const char* t_end, Visitor t_visitor, InstructionSet t_set) {
+        scan(t_begin, t_end, t_visitor, getMaskFunction(t_set));
+    }
+
+private:
+    /**
+     * Calls a function with each token, classifying whole blocks with a given classifier.
+     */
+    template <typename Visitor>
+    static void scan(const char* t_begin, const char* t_end, Visitor& t_visitor, MaskFunction t_mask) {
+        // Start of the token being read, null between tokens; a token may span blocks
+        const char* tokenStart = nullptr;
+        const char* block = t_begin;
+        while (t_end - block >= 64) {
+            uint64_t whitespace = t_mask(block);
+            unsigned position = 0;
+            while (position < 64) {
+                if (tokenStart == nullptr) {
+                    uint64_t tokenBytes = ~whitespace >> position;
+                    if (tokenBytes == 0) {
+                        break;
+                    }
+                    position += lowestSetBit(tokenBytes);
+                    tokenStart = block + position;
+                }
+                uint64_t whitespaceBytes = whitespace >> position;
+                if (whitespaceBytes == 0) {
+                    break;
+                }
+                position += lowestSetBit(whitespaceBytes);
+                t_visitor(tokenStart, block + position);
+                tokenStart = nullptr;
+            }
+            block += 64;
+        }
+
+        // The last partial block, byte by byte
+        for (const char* cursor = block; cursor < t_end; ++cursor) {
+            if (Utils::isWhitespace(*cursor)) {
+                if (tokenStart != nullptr) {
+                    t_visitor(tokenStart, cursor);
+                    tokenStart = nullptr;
+                }
+            } else if (tokenStart == nullptr) {
+                tokenStart = cursor;
+            }
+        }
+        if (tokenStart != nullptr) {
+            t_visitor(tokenStart, t_end);
+        }
+    }
+};
+
+/**
+ * Bump allocator that stores strings back to back in large blocks.
+ * Interned strings are never moved or freed individually, so views into the
+ * arena stay valid until the arena itself is destroyed.
+ */
+class StringArena {
+private:
+    static const size_t BLOCK_SIZE = 64 * 1024;
+    std::vector<std::unique_ptr<char[]>> m_blocks;
+    char* m_cursor = nullptr;
+    size_t m_remaining = 0;
+    size_t m_bytesUsed = 0;
+
+public:
+    /**
+     * Copies a string into the arena.
+     *
+     * @param t_str the string to copy
+     * @return a view of the copy owned by the arena
+     */
+    StringView intern(StringView t_str) {
+        if (t_str.size() > m_remaining) {
+            // Long strings get a block of their own so the current block is not wasted
+            if (t_str.size() > BLOCK_SIZE / 4) {
+                m_blocks.emplace_back(new char[t_str.size()]);
+                std::memcpy(m_blocks.back().get(), t_str.data(), t_str.size());
+                m_bytesUsed += t_str.size();
+                return StringView(m_blocks.back().get(), t_str.size());
+            }
+            m_blocks.emplace_back(new char[BLOCK_SIZE]);
+            m_cursor = m_blocks.back().get();
+            m_remaining = BLOCK_SIZE;
+        }
+        if (t_str.size() > 0) {
+            std::memcpy(m_cursor, t_str.data(), t_str.size());
+        }
+        StringView interned(m_cursor, t_str.size());
+        m_cursor += t_str.size();
+        m_remaining -= t_str.size();
+        m_bytesUsed += t_str.size();
+        return interned;
+    }
+
+    /**
+     * Gets the number of bytes stored in the arena.
+     *
+     * @return the total length of the interned strings
+     */
+    size_t bytesUsed() const {
+        return m_bytesUsed;
+    }
+};
+
+/**
+ * Interned item names with their counts.
+ * Each distinct name is stored once in a StringArena and given a stable ItemId
+ * in order of first sight. Names, hashes and counts live in arrays indexed by
+ * ItemId, and an open addressing hash table with linear probing maps names to
+ * ids. Lookups take a StringView so no key is built to search. The table is
+ * unordered; sortedByName() produces an ordered view of ids when one is needed.
+ */
+class ItemTable {
+public:
+    typedef uint32_t ItemId;
+    static const ItemId NOT_FOUND = 0xFFFFFFFFu;
+
+private:
+    struct Slot {
+        uint32_t hash = 0;  // 0 marks an empty slot
+        ItemId id = 0;
+    };
+
+    /**
+     * Reads a name one character at a time in its normalized form: ASCII letters
+     * lowercased, leading and trailing whitespace dropped, inner runs of whitespace
+     * read as one space. Normalizing on the fly lets lookups avoid building a key.
+     */
+    class FoldedReader {
+    private:
+        const char* m_cursor;
+        const char* m_end;
+
+    public:
+        explicit FoldedReader(StringView t_name) : m_cursor(t_name.data()), m_end(t_name.data() + t_name.size()) {
+            while (m_cursor < m_end && Utils::isWhitespace(*m_cursor)) {
+                ++m_cursor;
+            }
+            while (m_end > m_cursor && Utils::isWhitespace(*(m_end - 1))) {
+                --m_end;
+            }
+        }
+
+        /**
+         * Gets the next normalized character.
+         *
+         * @return the character, -1 at the end of the name
+         */
+        int next() {
+            if (m_cursor == m_end) {
+                return -1;
+            }
+            char c = *m_cursor++;
+            if (Utils::isWhitespace(c)) {
+                while (m_cursor < m_end && Utils::isWhitespace(*m_cursor)) {
+                    ++m_cursor;
+                }
+                return ' ';
+            }
+            return (c >= 'A' && c <= 'Z') ? c - 'A' + 'a' : static_cast<unsigned char>(c);
+        }
+    };
+
+    StringArena m_arena;
+    std::vector<StringView> m_names;
+    std::vector<uint32_t> m_hashes;
+    std::vector<uint32_t> m_foldedHashes;
+    std::vector<int> m_counts;
+    std::vector<Slot> m_slots;
+    std::vector<Slot> m_foldedSlots;
+    size_t m_mask = 0;
+
+    /**
+     * Hashes the normalized form of a name with 32 bit FNV-1a.
+     *
+     * @param t_name the name to hash
+     * @return the hash, never 0
+     */
+    static uint32_t foldedHash(StringView t_name) {
+        uint32_t result = 2166136261u;
+        FoldedReader reader(t_name);
+        for (int c = reader.next(); c >= 0; c = reader.next()) {
+            result ^= static_cast<uint32_t>(c);
+            result *= 16777619u;
+        }
+        return result == 0 ? 1 : result;
+    }
+
+    /**
+     * Checks if two names have the same normalized form.
+     */
+    static bool foldedEquals(StringView t_left, StringView t_right) {
+        FoldedReader left(t_left);
+        FoldedReader right(t_right);
+        int c;
+        do {
+            c = left.next();
+            if (c != right.next()) {
+                return false;
+            }
+        } while (c >= 0);
+        return true;
+    }
+
+    /**
+     * Finds the slot in the normalized index for a name, either the slot of the first
+     * item with that normalized form or the empty slot where it belongs.
+     */
+    size_t probeFolded(StringView t_name, uint32_t t_foldedHash) const {
+        size_t index = t_foldedHash & m_mask;
+        while (m_foldedSlots[index].hash != 0 &&
+               (m_foldedSlots[index].hash != t_foldedHash || !foldedEquals(m_names[m_foldedSlots[index].id], t_name))) {
+            index = (index + 1) & m_mask;
+        }
+        return index;
+    }
+
+    /**
+     * Finds the slot for a name, either the slot holding it or the empty slot where it belongs.
+     *
+     * @param t_name the name to find
+     * @param t_hash the hash of the name
+     * @return the index of the slot
+     */
+    size_t probe(StringView t_name, uint32_t t_hash) const {
+        size_t index = t_hash & m_mask;
+        while (m_slots[index].hash != 0 && (m_slots[index].hash != t_hash || m_names[m_slots[index].id] != t_name)) {
+            index = (index + 1) & m_mask;
+        }
+        return index;
+    }
+
+    /**
+     * Doubles the capacity and reinserts every id using its stored hashes.
+     */
+    void grow() {
+        m_slots.assign(m_slots.empty() ? 16 : m_slots.size() * 2, Slot());
+        m_foldedSlots.assign(m_slots.size(), Slot());
+        m_mask = m_slots.size() - 1;
+        for (ItemId id = 0; id < m_hashes.size(); id++) {
+            size_t index = m_hashes[id] & m_mask;
+            while (m_slots[index].hash != 0) {
+                index = (index + 1) & m_mask;
+            }
+            m_slots[index].hash = m_hashes[id];
+            m_slots[index].id = id;
+
+            // Ids are visited in order, so the first item of each normalized form keeps its place
+            size_t foldedIndex = probeFolded(m_names[id], m_foldedHashes[id]);
+            if (m_foldedSlots[foldedIndex].hash == 0) {
+                m_foldedSlots[foldedIndex].hash = m_foldedHashes[id];
+                m_foldedSlots[foldedIndex].id = id;
+            }
+        }
+    }
+
+public:
+    /**
+     * Hashes a name with 32 bit FNV-1a.
+     *
+     * @param t_name the name to hash
+     * @return the hash, never 0
+     */
+    static uint32_t hash(StringView t_name) {
+        uint32_t result = 2166136261u;
+        for (size_t i = 0; i < t_name.size(); i++) {
+            result ^= static_cast<unsigned char>(t_name.data()[i]);
+            result *= 16777619u;
+        }
+        return result == 0 ? 1 : result;
+    }
+
+    /**
+     * Gets the id of an item whose hash is already known, interning it on first sight.
+     *
+     * @param t_name the item name
+     * @param t_hash the hash of the name from hash()
+     * @return the id of the item
+     */
+    ItemId intern(StringView t_name, uint32_t t_hash) {
+        // Keep the load factor at or below 3/4
+        if ((m_names.size() + 1) * 4 > m_slots.size() * 3) {
+            grow();
+        }
+        Slot& slot = m_slots[probe(t_name, t_hash)];
+        if (slot.hash == 0) {
+            slot.hash = t_hash;
+            slot.id = static_cast<ItemId>(m_names.size());
+            m_names.push_back(m_arena.intern(t_name));
+            m_hashes.push_back(t_hash);
+            m_counts.push_back(0);
+
+            // Index the normalized form unless an earlier item already has it
+            uint32_t folded = foldedHash(t_name);
+            m_foldedHashes.push_back(folded);
+            Slot& foldedSlot = m_foldedSlots[probeFolded(t_name, folded)];
+            if (foldedSlot.hash == 0) {
+                foldedSlot.hash = folded;
+                foldedSlot.id = slot.id;
+            }
+        }
+        return slot.id;
+    }
+
+    /**
+     * Adds to the count of an item, inserting it on first sight.
+     *
+     * @param t_name the item name
+     * @param t_amount the amount to add
+     * @return the new count
+     */
+    int add(StringView t_name, int t_amount = 1) {
+        return m_counts[intern(t_name, hash(t_name))] += t_amount;
+    }
+
+    /**
+     * Adds to the count of an item by id.
+     *
+     * @param t_id the id of the item
+     * @param t_amount the amount to add
+     * @return the new count
+     */
+    int addToCount(ItemId t_id, int t_amount) {
+        return m_counts[t_id] += t_amount;
+    }
+
+    /**
+     * Finds the id of an item.
+     *
+     * @param t_name the item name
+     * @return the id of the item, NOT_FOUND if the item is not in the table
+     */
+    ItemId find(StringView t_name) const {
+        if (m_names.empty()) {
+            return NOT_FOUND;
+        }
+        const Slot& slot = m_slots[probe(t_name, hash(t_name))];
+        if (slot.hash == 0) {
+            return NOT_FOUND;
+        }
+        return slot.id;
+    }
+
+    /**
+     * Appends the normalized form of a name used by findFolded().
+     *
+     * @param t_name the name to normalize
+     * @param t_folded the string to append to
+     */
+    static void appendFolded(StringView t_name, std::string& t_folded) {
+        FoldedReader reader(t_name);
+        for (int c = reader.next(); c >= 0; c = reader.next()) {
+            t_folded.push_back(static_cast<char>(c));
+        }
+    }
+
+    /**
+     * Finds the id of an item ignoring ASCII case and differences in whitespace.
+     * When several items share a normalized form, the first one seen is returned.
+     *
+     * @param t_name the item name in any casing
+     * @return the id of the item, NOT_FOUND if no item matches
+     */
+    ItemId findFolded(StringView t_name) const {
+        if (m_names.empty()) {
+            return NOT_FOUND;
+        }
+        const Slot& slot = m_foldedSlots[probeFolded(t_name, foldedHash(t_name))];
+        if (slot.hash == 0) {
+            return NOT_FOUND;
+        }
+        return slot.id;
+    }
+
+    /**
+     * Merges the counts of another table into this one, reusing its stored hashes.
+     *
+     * @param t_other the table to merge
+     */
+    void merge(const ItemTable& t_other) {
+        merge(t_other, [](ItemId) {});
+    }
+
+    /**
+     * Merges the counts of another table into this one and reports each item that was merged.
+     *
+     * @param t_other the table to merge
+     * @param t_visitor called with the id in this table of each merged item, after its count is updated
+     */
+    template <typename Visitor>
+    void merge(const ItemTable& t_other, Visitor t_visitor) {
+        for (ItemId id = 0; id < t_other.size(); id++) {
+            ItemId mergedId = intern(t_other.m_names[id], t_other.m_hashes[id]);
+            m_counts[mergedId] += t_other.m_counts[id];
+            t_visitor(mergedId);
+        }
+    }
+
+    /**
+     * Gets the number of distinct items, which is also one past the largest id.
+     *
+     * @return the number of items in the table
+     */
+    size_t size() const {
+        return m_names.size();
+    }
+
+    /**
+     * Gets the name of an item.
+     *
+     * @param t_id the id of the item
+     * @return view of the interned name
+     */
+    StringView name(ItemId t_id) const {
+        return m_names[t_id];
+    }
+
+    /**
+     * Gets the count of an item.
+     *
+     * @param t_id the id of the item
+     * @return the count of the item
+     */
+    int count(ItemId t_id) const {
+        return m_counts[t_id];
+    }
+
+    /**
+     * Gets the ids of all items ordered by item name.
+     *
+     * @return the ids sorted by name
+     */
+    std::vector<ItemId> sortedByName() const {
+        std::vector<ItemId> sorted(m_names.size());
+        for (ItemId id = 0; id < sorted.size(); id++) {
+            sorted[id] = id;
+        }
+        std::sort(sorted.begin(), sorted.end(), [this](ItemId t_left, ItemId t_right) {
+            return m_names[t_left] < m_names[t_right];
+        });
+        return sorted;
+    }
+
+    /**
+     * Calls a function for every item in id order.
+     *
+     * @param t_visitor called with the name and count of each item
+     */
+    template <typename Visitor>
+    void forEach(Visitor t_visitor) const {
+        for (ItemId id = 0; id < m_names.size(); id++) {
+            t_visitor(m_names[id], m_counts[id]);
+        }
+    }
+};
+
+/**
+ * Keeps the items of a table ordered by count so the best and worst sellers and the
+ * items in a count range can be read without sorting the whole table.
+ * Items of equal count form one run, so a changed count moves an item by swapping it
+ * across the runs between its old and new count rather than shifting every item.
+ */
+class CountIndex {
+private:
+    std::vector<ItemTable::ItemId> m_order;  // ascending count
+    std::vector<uint32_t> m_positions;       // position of each id in m_order
+
+    void place(size_t t_position, ItemTable::ItemId t_id) {
+        m_order[t_position] = t_id;
+        m_positions[t_id] = static_cast<uint32_t>(t_position);
+    }
+
+    /**
+     * Finds the first position in [t_first, t_last) whose count is at least a value.
+     */
+    size_t lowerBound(size_t t_first, size_t t_last, long long t_count, const ItemTable& t_counts) const {
+        return static_cast<size_t>(std::lower_bound(m_order.begin() + t_first, m_order.begin() + t_last, t_count, [&t_counts](ItemTable::ItemId t_id, long long t_value) {
+            return t_counts.count(t_id) < t_value;
+        }) - m_order.begin());
+    }
+
+    size_t lowerBound(long long t_count, const ItemTable& t_counts) const {
+        return lowerBound(0, m_order.size(), t_count, t_counts);
+    }
+
+public:
+    /**
+     * Orders all items of a table by count.
+     *
+     * @param t_counts the table to index
+     */
+    void rebuild(const ItemTable& t_counts) {
+        // Sort count and id packed together so the comparison needs no lookups; the sign bit
+        // is flipped so a transient negative count still orders below 0
+        std::vector<uint64_t> keys(t_counts.size());
+        for (ItemTable::ItemId id = 0; id < keys.size(); id++) {
+            keys[id] = static_cast<uint64_t>(static_cast<uint32_t>(t_counts.count(id)) ^ 0x80000000u) << 32 | id;
+        }
+        std::sort(keys.begin(), keys.end());
+        m_order.resize(keys.size());
+        m_positions.resize(keys.size());
+        for (size_t i = 0; i < keys.size(); i++) {
+            place(i, static_cast<ItemTable::ItemId>(keys[i]));
+        }
+    }
+
+    /**
+     * Moves an item to its place after its count changed. Items new to the table are added.
+     *
+     * @param t_id the item whose count changed
+     * @param t_counts the table the index was built from
+     */
+    void update(ItemTable::ItemId t_id, const ItemTable& t_counts) {
+        if (t_id >= m_positions.size()) {
+            m_positions.resize(t_id + 1);
+            m_order.push_back(t_id);
+            m_positions[t_id] = static_cast<uint32_t>(m_order.size() - 1);
+        }
+        int count = t_counts.count(t_id);
+        size_t position = m_positions[t_id];
+
+        // Swap with the last item of each lower run passed, or the first of each higher run.
+        // Only the side the item moves into is searched, as its own slot is out of order.
+        while (position + 1 < m_order.size() && t_counts.count(m_order[position + 1]) < count) {
+            long long runCount = t_counts.count(m_order[position + 1]);
+            size_t runEnd = lowerBound(position + 1, m_order.size(), runCount + 1, t_counts) - 1;
+            place(position, m_order[runEnd]);
+            position = runEnd;
+        }
+        while (position > 0 && t_counts.count(m_order[position - 1]) > count) {
+            size_t runStart = lowerBound(0, position, t_counts.count(m_order[position - 1]), t_counts);
+            place(position, m_order[runStart]);
+            position = runStart;
+        }
+        place(position, t_id);
+    }
+
+    /**
+     * Gets the highest count.
+     *
+     * @param t_counts the table the index was built from
+     * @return the highest count, 0 if the table is empty
+     */
+    int maxCount(const ItemTable& t_counts) const {
+        return m_order.empty() ? 0 : std::max(0, t_counts.count(m_order.back()));
+    }
+
+    /**
+     * Gets the items with the highest counts.
+     *
+     * @param t_limit the most items to return
+     * @param t_counts the table the index was built from
+     * @return the item ids, highest count first, ties ordered by name
+     */
+    std::vector<ItemTable::ItemId> top(size_t t_limit, const ItemTable& t_counts) const {
+        size_t first = lowerBound(1, t_counts);
+        if (t_limit == 0 || first == m_order.size()) {
+            return std::vector<ItemTable::ItemId>();
+        }
+
+        // Ties at the cut are broken by name, so the whole run of the lowest count taken competes
+        size_t cut = m_order.size() - std::min(t_limit, m_order.size() - first);
+        std::vector<ItemTable::ItemId> ids(m_order.begin() + lowerBound(t_counts.count(m_order[cut]), t_counts), m_order.end());
+        selectTop(ids, t_counts, t_limit);
+        return ids;
+    }
+
+    /**
+     * Gets the items with the lowest counts, ignoring items with a count of 0.
+     *
+     * @param t_limit the most items to return
+     * @param t_counts the table the index was built from
+     * @return the item ids, lowest count first, ties ordered by name
+     */
+    std::vector<ItemTable::ItemId> bottom(size_t t_limit, const ItemTable& t_counts) const {
+        size_t first = lowerBound(1, t_counts);
+        if (t_limit == 0 || first == m_order.size()) {
+            return std::vector<ItemTable::ItemId>();
+        }
+        size_t cut = first + std::min(t_limit, m_order.size() - first) - 1;
+        std::vector<ItemTable::ItemId> ids(m_order.begin() + first, m_order.begin() + lowerBound(static_cast<long long>(t_counts.count(m_order[cut])) + 1, t_counts));
+        auto byCount = [&t_counts](ItemTable::ItemId t_left, ItemTable::ItemId t_right) {
+            if (t_counts.count(t_left) != t_counts.count(t_right)) {
+                return t_counts.count(t_left) < t_counts.count(t_right);
+            }
+            return t_counts.name(t_left) < t_counts.name(t_right);
+        };
+        if (ids.size() > t_limit) {
+            std::nth_element(ids.begin(), ids.begin() + t_limit, ids.end(), byCount);
+            ids.resize(t_limit);
+        }
+        std::sort(ids.begin(), ids.end(), byCount);
+        return ids;
+    }
+
+    /**
+     * Gets the items whose count is within a range.
+     *
+     * @param t_min the lowest count to include, counts below 1 are never included
+     * @param t_max the highest count to include
+     * @param t_limit the most items to return
+     * @param t_counts the table the index was built from
+     * @return the item ids, highest count first, ties ordered by name
+     */
+    std::vector<ItemTable::ItemId> inRange(int t_min, int t_max, size_t t_limit, const ItemTable& t_counts) const {
+        size_t first = lowerBound(std::max(t_min, 1), t_counts);
+        size_t last = lowerBound(static_cast<long long>(t_max) + 1, t_counts);
+        if (first >= last) {
+            return std::vector<ItemTable::ItemId>();
+        }
+        std::vector<ItemTable::ItemId> ids(m_order.begin() + first, m_order.begin() + last);
+        selectTop(ids, t_counts, t_limit);
+        return ids;
+    }
+
+    /**
+     * Keeps the items with the highest counts, highest first, ties ordered by name.
+     *
+     * @param t_ids the items to select from, replaced by the selection
+     * @param t_counts the table holding the counts
+     * @param t_limit the most items to keep
+     */
+    static void selectTop(std::vector<ItemTable::ItemId>& t_ids, const ItemTable& t_counts, size_t t_limit) {
+        auto byCount = [&t_counts](ItemTable::ItemId t_left, ItemTable::ItemId t_right) {
+            if (t_counts.count(t_left) != t_counts.count(t_right)) {
+                return t_counts.count(t_left) > t_counts.count(t_right);
+            }
+            return t_counts.name(t_left) < t_counts.name(t_right);
+        };
+        if (t_ids.size() > t_limit) {
+            std::nth_element(t_ids.begin(), t_ids.begin() + t_limit, t_ids.end(), byCount);
+            t_ids.resize(t_limit);
+        }
+        std::sort(t_ids.begin(), t_ids.end(), byCount);
+    }
+};
+
+/**
+ * Index over item names for prefix completion and typo tolerant search.
+ * Names are normalized as in ItemTable::findFolded(). Prefix queries binary search
+ * an array of the normalized names in sorted order. Fuzzy queries count shared
+ * trigrams through sorted posting lists to pick candidates, then rank them by
+ * edit distance. Results are ranked by count using the table the index was built from.
+ */
+class SearchIndex {
+private:
+    struct Entry {
+        uint32_t offset;
+        uint32_t length;
+        ItemTable::ItemId id;
+    };
+
+    std::string m_foldedNames;
+    std::vector<Entry> m_sorted;
+    std::vector<uint64_t> m_postings;  // trigram in the high 32 bits, entry index in the low 32 bits
+
+    StringView foldedName(const Entry& t_entry) const {
+        return StringView(m_foldedNames.data() + t_entry.offset, t_entry.length);
+    }
+
+    /**
+     * Calls a function with each trigram of a normalized name padded with boundary markers.
+     */
+    template <typename Visitor>
+    static void forEachTrigram(StringView t_folded, Visitor t_visitor) {
+        const uint32_t boundary = 0x01;
+        uint32_t window = boundary;
+        for (size_t i = 0; i <= t_folded.size(); i++) {
+            uint32_t next = i < t_folded.size() ? static_cast<unsigned char>(t_folded.data()[i]) : boundary;
+            window = (window << 8 | next) & 0xFFFFFF;
+            if (i >= 1) {
+                t_visitor(window);
+            }
+        }
+    }
+
+    /**
+     * Computes the edit distance between two strings, giving up once it exceeds a bound.
+     *
+     * @return the edit distance, or t_maxDistance + 1 if it is larger than t_maxDistance
+     */
+    static size_t boundedEditDistance(StringView t_left, StringView t_right, size_t t_maxDistance) {
+        size_t lengthGap = t_left.size() > t_right.size() ? t_left.size() - t_right.size() : t_right.size() - t_left.size();
+        if (lengthGap > t_maxDistance) {
+            return t_maxDistance + 1;
+        }
+        std::vector<size_t> previous(t_right.size() + 1);
+        std::vector<size_t> current(t_right.size() + 1);
+        for (size_t j = 0; j <= t_right.size(); j++) {
+            previous[j] = j;
+        }
+        for (size_t i = 1; i <= t_left.size(); i++) {
+            current[0] = i;
+            size_t rowMinimum = current[0];
+            for (size_t j = 1; j <= t_right.size(); j++) {
+                size_t substitution = previous[j - 1] + (t_left.data()[i - 1] == t_right.data()[j - 1] ? 0 : 1);
+                current[j] = std::min(std::min(previous[j] + 1, current[j - 1] + 1), substitution);
+                rowMinimum = std::min(rowMinimum, current[j]);
+            }
+            if (rowMinimum > t_maxDistance) {
+                return t_maxDistance + 1;
+            }
+            previous.swap(current);
+        }
+        return std::min(previous[t_right.size()], t_maxDistance + 1);
+    }
+
+public:
+    /**
+     * Builds the index.
+     *
+     * @param t_counts the table holding the names
+     * @param t_ids the ids to index
+     */
+    void build(const ItemTable& t_counts, const std::vector<ItemTable::ItemId>& t_ids) {
+        m_foldedNames.clear();
+        m_sorted.clear();
+        m_postings.clear();
+        m_sorted.reserve(t_ids.size());
+        for (ItemTable::ItemId id : t_ids) {
+            Entry entry;
+            entry.offset = static_cast<uint32_t>(m_foldedNames.size());
+            ItemTable::appendFolded(t_counts.name(id), m_foldedNames);
+            entry.length = static_cast<uint32_t>(m_foldedNames.size() - entry.offset);
+            entry.id = id;
+            m_sorted.push_back(entry);
+        }
+        std::sort(m_sorted.begin(), m_sorted.end(), [this](const Entry& t_left, const Entry& t_right) {
+            return foldedName(t_left) < foldedName(t_right);
+        });
+        m_postings.reserve(m_foldedNames.size() + m_sorted.size());
+        for (uint32_t i = 0; i < m_sorted.size(); i++) {
+            forEachTrigram(foldedName(m_sorted[i]), [this, i](uint32_t t_trigram) {
+                m_postings.push_back(static_cast<uint64_t>(t_trigram) << 32 | i);
+            });
+        }
+
+        // Postings were added in entry order, so a stable radix sort on the 24 bit trigram
+        // leaves each posting list sorted by entry as well
+        std::vector<uint64_t> sorted(m_postings.size());
+        for (int shift = 32; shift < 56; shift += 12) {
+            std::vector<size_t> offsets(4097, 0);
+            for (uint64_t posting : m_postings) {
+                offsets[((posting >> shift) & 0xFFF) + 1]++;
+            }
+            for (size_t i = 1; i < offsets.size(); i++) {
+                offsets[i] += offsets[i - 1];
+            }
+            for (uint64_t posting : m_postings) {
+                sorted[offsets[(posting >> shift) & 0xFFF]++] = posting;
+            }
+            m_postings.swap(sorted);
+        }
+        m_postings.erase(std::unique(m_postings.begin(), m_postings.end()), m_postings.end());
+    }
+
+    /**
+     * Finds the items whose names start with a prefix, ignoring case.
+     *
+     * @param t_prefix the prefix
+     * @param t_counts the table the index was built from
+     * @param t_limit the most results to return
+     * @return the best selling matches, highest count first
+     */
+    std::vector<ItemTable::ItemId> completePrefix(StringView t_prefix, const ItemTable& t_counts, size_t t_limit) const {
+        std::string folded;
+        ItemTable::appendFolded(t_prefix, folded);
+        StringView prefix(folded);
+
+        // Names with the prefix form one run in sorted order
+        auto first = std::lower_bound(m_sorted.begin(), m_sorted.end(), prefix, [this](const Entry& t_entry, StringView t_prefix) {
+            return foldedName(t_entry) < t_prefix;
+        });
+        std::vector<ItemTable::ItemId> matches;
+        for (auto it = first; it != m_sorted.end(); ++it) {
+            StringView name = foldedName(*it);
+            if (name.size() < prefix.size() || (prefix.size() > 0 && std::memcmp(name.data(), prefix.data(), prefix.size()) != 0)) {
+                break;
+            }
+            matches.push_back(it->id);
+        }
+        CountIndex::selectTop(matches, t_counts, t_limit);
+        return matches;
+    }
+
+    /**
+     * Finds the items whose names are closest to a possibly misspelled name.
+     * Up to one edit is allowed for short names and one more per five characters, at most three.
+     *
+     * @param t_name the name to search for
+     * @param t_counts the table the index was built from
+     * @param t_limit the most results to return
+     * @return the closest matches, fewest edits first, then highest count
+     */
+    std::vector<ItemTable::ItemId> findSimilar(StringView t_name, const ItemTable& t_counts, size_t t_limit) const {
+        std::string folded;
+        ItemTable::appendFolded(t_name, folded);
+        if (folded.empty() || m_sorted.empty()) {
+            return std::vector<ItemTable::ItemId>();
+        }
+        size_t maxDistance = std::min<size_t>(3, 1 + folded.size() / 5);
+
+        // Count the trigrams each name shares with the query
+        std::vector<uint32_t> queryTrigrams;
+        forEachTrigram(folded, [&queryTrigrams](uint32_t t_trigram) {
+            queryTrigrams.push_back(t_trigram);
+        });
+        std::sort(queryTrigrams.begin(), queryTrigrams.end());
+        queryTrigrams.erase(std::unique(queryTrigrams.begin(), queryTrigrams.end()), queryTrigrams.end());
+        std::unordered_map<uint32_t, uint32_t> sharedTrigrams;
+        for (uint32_t trigram : queryTrigrams) {
+            auto first = std::lower_bound(m_postings.begin(), m_postings.end(), static_cast<uint64_t>(trigram) << 32);
+            for (auto it = first; it != m_postings.end() && (*it >> 32) == trigram; ++it) {
+                sharedTrigrams[static_cast<uint32_t>(*it)]++;
+            }
+        }
+
+        // Each edit can break at most three trigrams, so names sharing too few cannot be close enough
+        size_t requiredShared = queryTrigrams.size() > 3 * maxDistance ? queryTrigrams.size() - 3 * maxDistance : 1;
+        std::vector<std::pair<size_t, ItemTable::ItemId>> ranked;
+        for (const auto& candidate : sharedTrigrams) {
+            if (candidate.second < requiredShared) {
+                continue;
+            }
+            const Entry& entry = m_sorted[candidate.first];
+            size_t distance = boundedEditDistance(folded, foldedName(entry), maxDistance);
+            if (distance <= maxDistance) {
+                ranked.push_back(std::make_pair(distance, entry.id));
+            }
+        }
+        std::sort(ranked.begin(), ranked.end(), [&t_counts](const std::pair<size_t, ItemTable::ItemId>& t_left, const std::pair<size_t, ItemTable::ItemId>& t_right) {
+            if (t_left.first != t_right.first) {
+                return t_left.first < t_right.first;
+            }
+            if (t_counts.count(t_left.second) != t_counts.count(t_right.second)) {
+                return t_counts.count(t_left.second) > t_counts.count(t_right.second);
+            }
+            return t_counts.name(t_left.second) < t_counts.name(t_right.second);
+        });
+        std::vector<ItemTable::ItemId> matches;
+        for (size_t i = 0; i < ranked.size() && i < t_limit; i++) {
+            matches.push_back(ranked[i].second);
+        }
+        return matches;
+    }
+};
+
+/**
+ * Heat map classification of item counts into a small number of buckets, lowest first.
+ * The bucket thresholds are worked out once per maximum count (or per distribution for the
+ * quantile scale), and the bucket of every item is kept in one byte per item id, so a lookup
+ * is an array read instead of floating point math per row. While the thresholds stay the
+ * same, only the items whose counts changed are classified again.
+ */
+class HeatMap {
+public:
+    enum Scale {
+        LINEAR,
+        LOG,
+        QUANTILE
+    };
+
+private:
+    Scale m_scale = LINEAR;
+    size_t m_bucketCount = 1;
+    // m_thresholds[b] is the lowest count in bucket b + 1
+    std::vector<int> m_thresholds;
+    std::vector<uint8_t> m_buckets;
+    int m_thresholdMaxCount = -1;
+
+    /**
+     * Works out the thresholds for a maximum count on the linear or log scale.
+     * A count goes to the bucket its rounded position between 0 and the maximum points at,
+     * the position being count / max on the linear scale and log(count) / log(max) on the log scale.
+     *
+     * @param t_maxCount the largest count of any item
+     */
+    void computeScaledThresholds(int t_maxCount) {
+        m_thresholds.assign(m_bucketCount - 1, INT_MAX);
+        if (t_maxCount <= 0) {
+            return;
+        }
+        for (size_t bucket = 1; bucket < m_bucketCount; bucket++) {
+            // The position rounds up to bucket + 1 from (bucket + 0.5) / bucketCount on
+            double position = (2.0 * bucket + 1.0) / (2.0 * m_bucketCount);
+            if (m_scale == LINEAR) {
+                long long scaled = static_cast<long long>(2 * bucket + 1) * t_maxCount;
+                long long divisor = static_cast<long long>(2 * m_bucketCount);
+                m_thresholds[bucket - 1] = static_cast<int>((scaled + divisor - 1) / divisor);
+            } else if (t_maxCount > 1) {
+                m_thresholds[bucket - 1] = static_cast<int>(std::ceil(std::pow(static_cast<double>(t_maxCount), position) - 1e-9));
+            }
+        }
+    }
+
+    /**
+     * Works out the thresholds that split the items into buckets of equal size by rank.
+     *
+     * @param t_counts the counts of the items
+     * @param t_byCount the items that have a count, highest first
+     */
+    void computeQuantileThresholds(const ItemTable& t_counts, const std::vector<ItemTable::ItemId>& t_byCount) {
+        m_thresholds.assign(m_bucketCount - 1, INT_MAX);
+        size_t itemTotal = t_byCount.size();
+        if (itemTotal == 0) {
+            return;
+        }
+        for (size_t bucket = 1; bucket < m_bucketCount; bucket++) {
+            // Items from this rank up, counting from the lowest, belong to this bucket or a higher one
+            size_t rank = bucket * itemTotal / m_bucketCount;
+            m_thresholds[bucket - 1] = t_counts.count(t_byCount[itemTotal - 1 - rank]);
+        }
+    }
+
+    /**
+     * Classifies every item against the current thresholds.
+     *
+     * @param t_counts the counts of the items
+     */
+    void classifyAll(const ItemTable& t_counts) {
+        m_buckets.resize(t_counts.size());
+        for (ItemTable::ItemId id = 0; id < m_buckets.size(); id++) {
+            m_buckets[id] = static_cast<uint8_t>(bucketOf(t_counts.count(id)));
+        }
+    }
+
+public:
+    /**
+     * Sets how counts are classified; takes effect on the next update.
+     *
+     * @param t_scale the scale the buckets are spread over
+     * @param t_bucketCount the number of buckets, from 1 to 255
+     */
+    void configure(Scale t_scale, size_t t_bucketCount) {
+        m_scale = t_scale;
+        m_bucketCount = std::max<size_t>(1, std::min<size_t>(t_bucketCount, 255));
+        m_thresholdMaxCount = -1;
+    }
+
+    /**
+     * Parses the name of a scale.
+     *
+     * @param t_name linear, log or quantile
+     * @param t_scale set to the scale if the name is known
+     * @return true if the name is known, false otherwise
+     */
+    static bool tryParseScale(const std::string& t_name, Scale& t_scale) {
+        if (t_name == "linear") {
+            t_scale = LINEAR;
+        } else if (t_name == "log") {
+            t_scale = LOG;
+        } else if (t_name == "quantile") {
+            t_scale = QUANTILE;
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * Gets how counts are classified.
+     *
+     * @return the scale; only QUANTILE needs the items ranked by count
+     */
+    Scale getScale() const {
+        return m_scale;
+    }
+
+    /**
+     * Classifies every item again on the quantile scale, whose thresholds depend on every count.
+     *
+     * @param t_counts the counts of the items
+     * @param t_byCount the items that have a count, highest first
+     */
+    void updateQuantiles(const ItemTable& t_counts, const std::vector<ItemTable::ItemId>& t_byCount) {
+        computeQuantileThresholds(t_counts, t_byCount);
+        classifyAll(t_counts);
+    }
+
+    /**
+     * Classifies every item again on the linear or log scale. The thresholds are only worked
+     * out again when the maximum count changed.
+     *
+     * @param t_counts the counts of the items
+     * @param t_maxCount the largest count of any item
+     */
+    void updateScaled(const ItemTable& t_counts, int t_maxCount) {
+        if (t_maxCount != m_thresholdMaxCount) {
+            computeScaledThresholds(t_maxCount);
+            m_thresholdMaxCount = t_maxCount;
+        }
+        classifyAll(t_counts);
+    }
+
+    /**
+     * Classifies the items whose counts changed on the linear or log scale. Every item is
+     * classified again only if the maximum count, and with it the thresholds, changed.
+     *
+     * @param t_counts the counts of the items
+     * @param t_maxCount the largest count of any item
+     * @param t_changedIds the items whose counts changed since the last update, including new ones
+     */
+    void updateScaled(const ItemTable& t_counts, int t_maxCount, const std::vector<ItemTable::ItemId>& t_changedIds) {
+        if (t_maxCount != m_thresholdMaxCount) {
+            updateScaled(t_counts, t_maxCount);
+            return;
+        }
+        m_buckets.resize(t_counts.size());
+        for (ItemTable::ItemId id : t_changedIds) {
+            m_buckets[id] = static_cast<uint8_t>(bucketOf(t_counts.count(id)));
+        }
+    }
+
+    /**
+     * Gets the bucket of a count that may not belong to an item, such as a windowed count.
+     *
+     * @param t_count the count
+     * @return the bucket, 0 for the lowest counts
+     */
+    size_t bucketOf(int t_count) const {
+        size_t bucket = 0;
+        while (bucket < m_thresholds.size() && t_count >= m_thresholds[bucket]) {
+            bucket++;
+        }
+        return bucket;
+    }
+
+    /**
+     * Gets the bucket of an item as of the last update.
+     *
+     * @param t_id the id of the item
+     * @return the bucket, 0 for the lowest counts
+     */
+    size_t bucket(ItemTable::ItemId t_id) const {
+        return t_id < m_buckets.size() ? m_buckets[t_id] : 0;
+    }
+};
+
+/**
+ * Item counts split into fixed length periods, such as hours or days, for timestamped input.
+ * Committed counts are stored column by column: the periods that have sales in ascending
+ * order, and for each one its own column of item ids and a parallel column of counts, both
+ * sorted by id. Periods without sales take no space. Counts are collected per open period
+ * while ingesting and merged by commit() into the columns of the periods they touch only,
+ * so an append costs the size of the changed periods rather than of all stored counts.
+ */
+class TimeBuckets {
+public:
+    struct Change {
+        long long period;
+        ItemTable::ItemId id;
+        int amount;
+    };
+
+private:
+    struct Column {
+        std::vector<ItemTable::ItemId> ids;
+        std::vector<int> counts;
+    };
+
+    std::vector<long long> m_periods;
+    std::vector<Column> m_columns;  // column of m_periods[i]
+
+    // Counts of the period being ingested, dense by id, and the changes not yet committed
+    long long m_openPeriod = -1;
+    std::vector<int> m_openCounts;
+    std::vector<ItemTable::ItemId> m_openIds;
+    std::vector<Change> m_staged;
+
+    void closeOpenPeriod() {
+        for (ItemTable::ItemId id : m_openIds) {
+            if (m_openCounts[id] != 0) {
+                Change change = { m_openPeriod, id, m_openCounts[id] };
+                m_staged.push_back(change);
+                m_openCounts[id] = 0;
+            }
+        }
+        m_openIds.clear();
+    }
+
+    size_t findPeriod(long long t_period) const {
+        return static_cast<size_t>(std::lower_bound(m_periods.begin(), m_periods.end(), t_period) - m_periods.begin());
+    }
+
+    /**
+     * Merges the net changes of one period, sorted by id, into its column.
+     * The column is created if the period had no sales and removed if it has none left.
+     *
+     * @param t_changes the first change of the period
+     * @param t_end one past the last change of the period
+     */
+    void mergeIntoPeriod(const Change* t_changes, const Change* t_end) {
+        size_t index = findPeriod(t_changes->period);
+        if (index == m_periods.size() || m_periods[index] != t_changes->period) {
+            m_periods.insert(m_periods.begin() + index, t_changes->period);
+            m_columns.insert(m_columns.begin() + index, Column());
+        }
+        Column& column = m_columns[index];
+
+        // A patch that only touches ids already in the column is applied in place
+        bool inPlace = true;
+        for (const Change* change = t_changes; change < t_end && inPlace; change++) {
+            auto it = std::lower_bound(column.ids.begin(), column.ids.end(), change->id);
+            inPlace = it != column.ids.end() && *it == change->id && column.counts[it - column.ids.begin()] + change->amount != 0;
+        }
+        if (inPlace) {
+            for (const Change* change = t_changes; change < t_end; change++) {
+                size_t entry = static_cast<size_t>(std::lower_bound(column.ids.begin(), column.ids.end(), change->id) - column.ids.begin());
+                column.counts[entry] += change->amount;
+            }
+            return;
+        }
+
+        Column merged;
+        merged.ids.reserve(column.ids.size() + static_cast<size_t>(t_end - t_changes));
+        merged.counts.reserve(column.ids.size() + static_cast<size_t>(t_end - t_changes));
+        auto append = [&merged](ItemTable::ItemId t_id, int t_count) {
+            if (t_count != 0) {
+                merged.ids.push_back(t_id);
+                merged.counts.push_back(t_count);
+            }
+        };
+        size_t entry = 0;
+        const Change* change = t_changes;
+        while (entry < column.ids.size() || change < t_end) {
+            if (change == t_end || (entry < column.ids.size() && column.ids[entry] < change->id)) {
+                append(column.ids[entry], column.counts[entry]);
+                entry++;
+            } else if (entry < column.ids.size() && column.ids[entry] == change->id) {
+                append(column.ids[entry], column.counts[entry] + change->amount);
+                entry++;
+                change++;
+            } else {
+                append(change->id, change->amount);
+                change++;
+            }
+        }
+        if (merged.ids.empty()) {
+            m_periods.erase(m_periods.begin() + index);
+            m_columns.erase(m_columns.begin() + index);
+        } else {
+            column = std::move(merged);
+        }
+    }
+
+public:
+    /**
+     * Adds to the count of an item in a period. The change is stored by commit().
+     *
+     * @param t_period the period index, not negative
+     * @param t_id the item id
+     * @param t_amount the amount to add, may be negative
+     */
+    void add(long long t_period, ItemTable::ItemId t_id, int t_amount) {
+        // Lines are usually in time order, so counts gather in one dense period at a time
+        if (t_period != m_openPeriod) {
+            closeOpenPeriod();
+            m_openPeriod = t_period;
+        }
+        if (t_id >= m_openCounts.size()) {
+            m_openCounts.resize(std::max<size_t>(t_id + 1, m_openCounts.size() * 2));
+        }
+        if (m_openCounts[t_id] == 0) {
+            m_openIds.push_back(t_id);
+        }
+        m_openCounts[t_id] += t_amount;
+    }
+
+    /**
+     * Stages the committed counts of another set of buckets, with its item ids translated.
+     *
+     * @param t_other the buckets to add, already committed
+     * @param t_idMap the id in this table of each id in the other table
+     */
+    void add(const TimeBuckets& t_other, const std::vector<ItemTable::ItemId>& t_idMap) {
+        closeOpenPeriod();
+        for (size_t i = 0; i < t_other.m_periods.size(); i++) {
+            const Column& column = t_other.m_columns[i];
+            for (size_t j = 0; j < column.ids.size(); j++) {
+                Change change = { t_other.m_periods[i], t_idMap[column.ids[j]], column.counts[j] };
+                m_staged.push_back(change);
+            }
+        }
+    }
+
+    /**
+     * Merges the staged counts into the columns of the periods they belong to.
+     *
+     * @return the net changes, sorted by period then id
+     */
+    std::vector<Change> commit() {
+        closeOpenPeriod();
+        std::vector<Change> changes;
+        if (m_staged.empty()) {
+            return changes;
+        }
+
+        // Combine the staged changes to one per period and item
+        std::sort(m_staged.begin(), m_staged.end(), [](const Change& t_left, const Change& t_right) {
+            return t_left.period != t_right.period ? t_left.period < t_right.period : t_left.id < t_right.id;
+        });
+        for (const Change& change : m_staged) {
+            if (!changes.empty() && changes.back().period == change.period && changes.back().id == change.id) {
+                changes.back().amount += change.amount;
+            } else {
+                changes.push_back(change);
+            }
+        }
+        m_staged.clear();
+        m_staged.shrink_to_fit();
+        changes.erase(std::remove_if(changes.begin(), changes.end(), [](const Change& t_change) {
+            return t_change.amount == 0;
+        }), changes.end());
+
+        // Merge each period's run of changes into that period's column only
+        for (size_t first = 0; first < changes.size();) {
+            size_t last = first;
+            while (last < changes.size() && changes[last].period == changes[first].period) {
+                last++;
+            }
+            mergeIntoPeriod(changes.data() + first, changes.data() + last);
+            first = last;
+        }
+        return changes;
+    }
+
+    /**
+     * Clears all counts.
+     */
+    void clear() {
+        *this = TimeBuckets();
+    }
+
+    /**
+     * Gets the latest period with sales.
+     *
+     * @return the period index, -1 if there are none
+     */
+    long long latestPeriod() const {
+        return m_periods.empty() ? -1 : m_periods.back();
+    }
+
+    /**
+     * Calls a function for each committed count in a range of periods.
+     *
+     * @param t_first the first period
+     * @param t_last one past the last period
+     * @param t_visitor called with the item id and count
+     */
+    template <typename Visitor>
+    void forEachInPeriods(long long t_first, long long t_last, Visitor t_visitor) const {
+        for (size_t i = findPeriod(t_first); i < m_periods.size() && m_periods[i] < t_last; i++) {
+            const Column& column = m_columns[i];
+            for (size_t j = 0; j < column.ids.size(); j++) {
+                t_visitor(column.ids[j], column.counts[j]);
+            }
+        }
+    }
+
+    /**
+     * Gets the count of one item over a range of periods.
+     *
+     * @param t_id the item id
+     * @param t_first the first period
+     * @param t_last one past the last period
+     * @return the total count in the range
+     */
+    long long count(ItemTable::ItemId t_id, long long t_first, long long t_last) const {
+        long long total = 0;
+        for (size_t i = findPeriod(t_first); i < m_periods.size() && m_periods[i] < t_last; i++) {
+            const Column& column = m_columns[i];
+            auto it = std::lower_bound(column.ids.begin(), column.ids.end(), t_id);
+            if (it != column.ids.end() && *it == t_id) {
+                total += column.counts[it - column.ids.begin()];
+            }
+        }
+        return total;
+    }
+};
+
+/**
+ * Running per item totals over the last few periods of a TimeBuckets.
+ * Moving the window forward adds the periods that enter and subtracts the periods that
+ * leave, so the cost depends on the buckets that changed rather than the window length.
+ */
+class TimeWindow {
+private:
+    long long m_length = 0;
+    long long m_end = -1;  // one past the last period, -1 until first filled
+    std::vector<long long> m_totals;
+
+    void addPeriods(const TimeBuckets& t_buckets, long long t_first, long long t_last, int t_sign) {
+        t_buckets.forEachInPeriods(t_first, t_last, [this, t_sign](ItemTable::ItemId t_id, int t_count) {
+            if (t_id >= m_totals.size()) {
+                m_totals.resize(t_id + 1, 0);
+            }
+            m_totals[t_id] += static_cast<long long>(t_sign) * t_count;
+        });
+    }
+
+public:
+    /**
+     * Empties the window and sets its length.
+     *
+     * @param t_length the number of periods covered
+     */
+    void reset(long long t_length) {
+        m_length = t_length;
+        m_end = -1;
+        m_totals.clear();
+    }
+
+    /**
+     * Gets the number of periods covered.
+     *
+     * @return the window length, 0 before the first reset()
+     */
+    long long getLength() const {
+        return m_length;
+    }
+
+    /**
+     * Gets the period the window ends before.
+     *
+     * @return one past the last period covered, -1 if the window is empty
+     */
+    long long getEnd() const {
+        return m_end;
+    }
+
+    /**
+     * Moves the window so it ends just before a period.
+     *
+     * @param t_end one past the last period to cover
+     * @param t_buckets the buckets the window sums
+     */
+    void advanceTo(long long t_end, const TimeBuckets& t_buckets) {
+        if (t_end == m_end) {
+            return;
+        }
+
+        // Only a short step forward can reuse the totals
+        if (m_end < 0 || t_end < m_end || t_end - m_end >= m_length) {
+            m_totals.assign(m_totals.size(), 0);
+            addPeriods(t_buckets, t_end - m_length, t_end, 1);
+        } else {
+            addPeriods(t_buckets, m_end, t_end, 1);
+            addPeriods(t_buckets, m_end - m_length, t_end - m_length, -1);
+        }
+        m_end = t_end;
+    }
+
+    /**
+     * Applies committed changes to periods the window already covers.
+     * Changes at or after the end are picked up by the next advanceTo().
+     *
+     * @param t_changes the changes returned by TimeBuckets::commit()
+     */
+    void apply(const std::vector<TimeBuckets::Change>& t_changes) {
+        if (m_end < 0) {
+            return;
+        }
+        for (const TimeBuckets::Change& change : t_changes) {
+            if (change.period >= m_end - m_length && change.period < m_end) {
+                if (change.id >= m_totals.size()) {
+                    m_totals.resize(change.id + 1, 0);
+                }
+                m_totals[change.id] += change.amount;
+            }
+        }
+    }
+
+    /**
+     * Gets the total of an item over the window.
+     *
+     * @param t_id the item id
+     * @return the total count
+     */
+    long long total(ItemTable::ItemId t_id) const {
+        return t_id < m_totals.size() ? m_totals[t_id] : 0;
+    }
+
+    /**
+     * Gets the items with the highest totals over the window.
+     *
+     * @param t_limit the most items to return
+     * @param t_counts the table the items belong to, used to order ties by name
+     * @return the item ids, highest total first
+     */
+    std::vector<ItemTable::ItemId> top(size_t t_limit, const ItemTable& t_counts) const {
+        std::vector<ItemTable::ItemId> ids;
+        for (ItemTable::ItemId id = 0; id < m_totals.size(); id++) {
+            if (m_totals[id] > 0) {
+                ids.push_back(id);
+            }
+        }
+        auto byTotal = [this, &t_counts](ItemTable::ItemId t_left, ItemTable::ItemId t_right) {
+            if (m_totals[t_left] != m_totals[t_right]) {
+                return m_totals[t_left] > m_totals[t_right];
+            }
+            return t_counts.name(t_left) < t_counts.name(t_right);
+        };
+        if (ids.size() > t_limit) {
+            std::nth_element(ids.begin(), ids.begin() + t_limit, ids.end(), byTotal);
+            ids.resize(t_limit);
+        }
+        std::sort(ids.begin(), ids.end(), byTotal);
+        return ids;
+    }
+};
+
+/**
+ * Count-Min Sketch: a fixed grid of counters that overestimates item counts by at most
+ * error * total with probability 1 - failure rate. Each row maps an item to one counter
+ * with its own hash derived from a 64 bit item hash, and the estimate is the row minimum.
+ */
+class CountMinSketch {
+private:
+    size_t m_width = 0;
+    size_t m_depth = 0;
+    std::vector<uint32_t> m_counters;
+
+public:
+    /**
+     * Sizes the sketch for an error bound and clears it.
+     *
+     * @param t_error the most a count is overestimated by, as a fraction of all counted items
+     * @param t_failureRate the probability of exceeding the error bound
+     */
+    void configure(double t_error, double t_failureRate) {
+        m_width = static_cast<size_t>(std::ceil(std::exp(1.0) / t_error));
+        m_depth = static_cast<size_t>(std::max(1.0, std::ceil(std::log(1.0 / t_failureRate))));
+        m_counters.assign(m_width * m_depth, 0);
+    }
+
+    /**
+     * Counts one sighting of an item.
+     *
+     * @param t_hash the 64 bit hash of the item
+     * @return the new estimate of the item's count
+     */
+    uint32_t add(uint64_t t_hash) {
+        // Rows use h1 + i * h2, which is as good as independent hashes for this purpose
+        uint32_t h1 = static_cast<uint32_t>(t_hash);
+        uint32_t h2 = static_cast<uint32_t>(t_hash >> 32) | 1;
+        uint32_t estimate = UINT32_MAX;
+        for (size_t row = 0; row < m_depth; row++) {
+            uint32_t& counter = m_counters[row * m_width + (h1 + row * h2) % m_width];
+            if (counter < UINT32_MAX) {
+                counter++;
+            }
+            estimate = std::min(estimate, counter);
+        }
+        return estimate;
+    }
+
+    /**
+     * Estimates the count of an item.
+     *
+     * @param t_hash the 64 bit hash of the item
+     * @return the estimate, never below the true count
+     */
+    uint32_t estimate(uint64_t t_hash) const {
+        uint32_t h1 = static_cast<uint32_t>(t_hash);
+        uint32_t h2 = static_cast<uint32_t>(t_hash >> 32) | 1;
+        uint32_t estimate = UINT32_MAX;
+        for (size_t row = 0; row < m_depth; row++) {
+            estimate = std::min(estimate, m_counters[row * m_width + (h1 + row * h2) % m_width]);
+        }
+        return estimate;
+    }
+
+    /**
+     * Gets the memory held by the counters.
+     *
+     * @return the size of the counters in bytes
+     */
+    size_t memoryUsage() const {
+        return m_counters.size() * sizeof(uint32_t);
+    }
+};
+
+/**
+ * HyperLogLog: estimates the number of distinct items from the longest run of leading zero
+ * bits seen in each of 2^precision registers, with a standard error of 1.04 / sqrt(2^precision).
+ */
+class HyperLogLog {
+private:
+    unsigned int m_precision = 0;
+    std::vector<uint8_t> m_registers;
+
+public:
+    /**
+     * Sizes the registers for a standard error and clears them.
+     *
+     * @param t_error the relative standard error wanted, limited to what 2^4 to 2^16 registers give
+     */
+    void configure(double t_error) {
+        double registers = std::pow(1.04 / t_error, 2.0);
+        m_precision = static_cast<unsigned int>(std::min(16.0, std::max(4.0, std::ceil(std::log2(registers)))));
+        m_registers.assign(static_cast<size_t>(1) << m_precision, 0);
+    }
+
+    /**
+     * Records one sighting of an item.
+     *
+     * @param t_hash the 64 bit hash of the item
+     */
+    void add(uint64_t t_hash) {
+        size_t index = static_cast<size_t>(t_hash >> (64 - m_precision));
+        uint64_t rest = (t_hash << m_precision) | (static_cast<uint64_t>(1) << (m_precision - 1));
+        uint8_t rank = 1;
+        while (!(rest & (static_cast<uint64_t>(1) << 63))) {
+            rest <<= 1;
+            rank++;
+        }
+        m_registers[index] = std::max(m_registers[index], rank);
+    }
+
+    /**
+     * Estimates the number of distinct items recorded.
+     *
+     * @return the estimate, rounded to the nearest whole item
+     */
+    size_t estimate() const {
+        double registerCount = static_cast<double>(m_registers.size());
+        double sum = 0;
+        size_t zeroRegisters = 0;
+        for (uint8_t value : m_registers) {
+            sum += std::ldexp(1.0, -static_cast<int>(value));
+            zeroRegisters += value == 0 ? 1 : 0;
+        }
+        double alpha = m_precision == 4 ? 0.673 : m_precision == 5 ? 0.697 : m_precision == 6 ? 0.709 : 0.7213 / (1.0 + 1.079 / registerCount);
+        double estimate = alpha * registerCount * registerCount / sum;
+
+        // Small cardinalities are counted more accurately from the empty registers
+        if (estimate <= 2.5 * registerCount && zeroRegisters > 0) {
+            estimate = registerCount * std::log(registerCount / static_cast<double>(zeroRegisters));
+        }
+        return static_cast<size_t>(estimate + 0.5);
+    }
+
+    /**
+     * Gets the memory held by the registers.
+     *
+     * @return the size of the registers in bytes
+     */
+    size_t memoryUsage() const {
+        return m_registers.size();
+    }
+};
+
+/**
+ * The items with the highest estimated counts, tracked exactly once they are admitted.
+ * While there is room every new item is admitted at its first sighting, so its count is
+ * exact. Once full, an item whose Count-Min estimate beats the lowest tracked bound replaces
+ * that entry; its sightings before admission are unknown and kept apart as an error, up to
+ * the estimate less one. A min heap keeps the lowest bound, count plus error, at hand, and
+ * entries are found by the 64 bit hash of their name ignoring case. Each entry shows the
+ * name in the casing it was first seen in.
+ */
+class HeavyHitters {
+private:
+    struct Entry {
+        std::string name;
+        uint64_t hash;
+        long long count;  // sightings since admission
+        long long error;  // most sightings before admission
+        size_t heapPosition;
+
+        /**
+         * Gets the highest the true count can be.
+         */
+        long long bound() const {
+            return count + error;
+        }
+    };
+
+    size_t m_capacity = 0;
+    std::vector<Entry> m_entries;
+    std::vector<size_t> m_heap;  // entry indices, lowest count first
+    std::unordered_map<uint64_t, size_t> m_byHash;
+
+    void swapHeap(size_t t_left, size_t t_right) {
+        std::swap(m_heap[t_left], m_heap[t_right]);
+        m_entries[m_heap[t_left]].heapPosition = t_left;
+        m_entries[m_heap[t_right]].heapPosition = t_right;
+    }
+
+    /**
+     * Checks if two item names are equal ignoring ASCII case. Items never contain whitespace.
+     */
+    static bool foldedEquals(StringView t_left, StringView t_right) {
+        if (t_left.size() != t_right.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < t_left.size(); i++) {
+            if (std::tolower(static_cast<unsigned char>(t_left.data()[i])) != std::tolower(static_cast<unsigned char>(t_right.data()[i]))) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void siftUp(size_t t_position) {
+        while (t_position > 0) {
+            size_t parent = (t_position - 1) / 2;
+            if (m_entries[m_heap[parent]].bound() <= m_entries[m_heap[t_position]].bound()) {
+                return;
+            }
+            swapHeap(parent, t_position);
+            t_position = parent;
+        }
+    }
+
+    void siftDown(size_t t_position) {
+        while (true) {
+            size_t smallest = t_position;
+            for (size_t child = t_position * 2 + 1; child <= t_position * 2 + 2 && child < m_heap.size(); child++) {
+                if (m_entries[m_heap[child]].bound() < m_entries[m_heap[smallest]].bound()) {
+                    smallest = child;
+                }
+            }
+            if (smallest == t_position) {
+                return;
+            }
+            swapHeap(smallest, t_position);
+            t_position = smallest;
+        }
+    }
+
+public:
+    /**
+     * Sets how many items are tracked and clears them.
+     *
+     * @param t_capacity the most items to track
+     */
+    void configure(size_t t_capacity) {
+        m_capacity = t_capacity;
+        m_entries.clear();
+        m_heap.clear();
+        m_byHash.clear();
+        m_entries.reserve(t_capacity);
+        m_heap.reserve(t_capacity);
+    }
+
+    /**
+     * Counts a sighting of an item, admitting it if its estimate is high enough.
+     *
+     * @param t_name the item name as it appears in the input
+     * @param t_hash the 64 bit hash of the item, the same for any casing
+     * @param t_estimate the Count-Min estimate of the item including this sighting
+     */
+    void offer(StringView t_name, uint64_t t_hash, long long t_estimate) {
+        // A tracked item's estimate never drops below its tracked count, so most of the tail stops here
+        bool full = m_entries.size() == m_capacity;
+        if (m_capacity == 0 || (full && t_estimate < m_entries[m_heap[0]].bound())) {
+            return;
+        }
+        auto found = m_byHash.find(t_hash);
+        if (found != m_byHash.end()) {
+            Entry& entry = m_entries[found->second];
+            if (foldedEquals(StringView(entry.name), t_name)) {
+                entry.count++;
+                siftDown(entry.heapPosition);
+            }
+            return;
+        }
+        if (!full) {
+            // Nothing was ever dropped while there is room, so this is the item's first sighting
+            Entry entry = { t_name.str(), t_hash, 1, 0, m_heap.size() };
+            m_byHash[t_hash] = m_entries.size();
+            m_heap.push_back(m_entries.size());
+            m_entries.push_back(std::move(entry));
+            siftUp(m_heap.size() - 1);
+        } else if (t_estimate > m_entries[m_heap[0]].bound()) {
+            // Replace the lowest tracked item
+            size_t index = m_heap[0];
+            m_byHash.erase(m_entries[index].hash);
+            m_entries[index].name = t_name.str();
+            m_entries[index].hash = t_hash;
+            m_entries[index].count = 1;
+            m_entries[index].error = t_estimate - 1;
+            m_byHash[t_hash] = index;
+            siftDown(0);
+        }
+    }
+
+    /**
+     * Calls a function for each tracked item.
+     *
+     * @param t_visitor called with the name, the count since admission and the error of each item;
+     *                  the true count is at least the count and at most the count plus the error
+     */
+    template <typename Visitor>
+    void forEach(Visitor t_visitor) const {
+        for (const Entry& entry : m_entries) {
+            t_visitor(StringView(entry.name), entry.count, entry.error);
+        }
+    }
+
+    /**
+     * Gets the memory held by the tracked items, including their names.
+     *
+     * @return the approximate size in bytes
+     */
+    size_t memoryUsage() const {
+        size_t bytes = m_entries.capacity() * sizeof(Entry) + m_heap.capacity() * sizeof(size_t) + m_byHash.size() * (sizeof(uint64_t) + 2 * sizeof(size_t));
+        for (const Entry& entry : m_entries) {
+            bytes += entry.name.capacity();
+        }
+        return bytes;
+    }
+};
+
+/**
+ * Approximate item counts in fixed memory for logs too large to count exactly.
+ * A Count-Min Sketch estimates any item's count, HeavyHitters keeps the best sellers with
+ * near exact counts, and a HyperLogLog estimates how many distinct items were seen.
+ * The sizes follow from the error bound alone, not from the input.
+ */
+class ApproximateCounter {
+private:
+    CountMinSketch m_sketch;
+    HyperLogLog m_distinctItems;
+    HeavyHitters m_heavyHitters;
+    double m_error = 0;
+    double m_failureRate = 0;
+    long long m_sightings = 0;
+
+public:
+    /**
+     * Hashes a name to 64 bits ignoring ASCII case, so an item is counted and looked up
+     * the same in any casing: FNV-1a with a final mix so every bit depends on every byte.
+     *
+     * @param t_name the name to hash
+     * @return the hash
+     */
+    static uint64_t hash(StringView t_name) {
+        uint64_t result = 14695981039346656037ull;
+        for (size_t i = 0; i < t_name.size(); i++) {
+            result ^= static_cast<unsigned char>(std::tolower(static_cast<unsigned char>(t_name.data()[i])));
+            result *= 1099511628211ull;
+        }
+        result ^= result >> 33;
+        result *= 0xff51afd7ed558ccdull;
+        result ^= result >> 33;
+        result *= 0xc4ceb9fe1a85ec53ull;
+        result ^= result >> 33;
+        return result;
+    }
+
+    /**
+     * Sizes the sketches for an error bound and clears them.
+     * The heavy hitters list holds 1 / error items, enough for every item whose share of
+     * the sightings is above the error.
+     *
+     * @param t_error the most an estimate is off by, as a fraction of all counted items
+     * @param t_failureRate the probability of exceeding the error bound
+     */
+    void configure(double t_error, double t_failureRate) {
+        m_error = t_error;
+        m_failureRate = t_failureRate;
+        m_sightings = 0;
+        m_sketch.configure(t_error, t_failureRate);
+        m_distinctItems.configure(t_error);
+        m_heavyHitters.configure(static_cast<size_t>(std::min(65536.0, std::ceil(1.0 / t_error))));
+    }
+
+    /**
+     * Clears the counts, keeping the error bound.
+     */
+    void clear() {
+        configure(m_error, m_failureRate);
+    }
+
+    /**
+     * Counts one sighting of an item.
+     *
+     * @param t_name the item name
+     */
+    void add(StringView t_name) {
+        uint64_t itemHash = hash(t_name);
+        m_heavyHitters.offer(t_name, itemHash, m_sketch.add(itemHash));
+        m_distinctItems.add(itemHash);
+        m_sightings++;
+    }
+
+    /**
+     * Gets the number of sightings counted.
+     *
+     * @return the total of all items' true counts
+     */
+    long long getSightings() const {
+        return m_sightings;
+    }
+
+    /**
+     * Estimates the count of an item.
+     *
+     * @param t_name the item name
+     * @return the estimate, never below the true count
+     */
+    long long estimate(StringView t_name) const {
+        return m_sketch.estimate(hash(t_name));
+    }
+
+    /**
+     * Estimates how many distinct items were counted.
+     *
+     * @return the estimated number of distinct items
+     */
+    size_t estimateDistinctItems() const {
+        return m_distinctItems.estimate();
+    }
+
+    /**
+     * Gets the heavy hitters.
+     *
+     * @return the tracked best sellers
+     */
+    const HeavyHitters& getHeavyHitters() const {
+        return m_heavyHitters;
+    }
+
+    /**
+     * Gets the memory held by the sketches and the heavy hitters.
+     *
+     * @return the approximate size in bytes
+     */
+    size_t memoryUsage() const {
+        return m_sketch.memoryUsage() + m_distinctItems.memoryUsage() + m_heavyHitters.memoryUsage();
+    }
+};
+
+/**
+ * Records how much of an append-only input file has already been counted.
+ * The file is identified by its size and by hashes of its first and last few
+ * kilobytes at the time of the checkpoint, so a file that was replaced or
+ * truncated rather than appended to is detected and rebuilt from scratch.
+ */
+class IngestCheckpoint {
+private:
+    static const size_t FINGERPRINT_SIZE = 4096;
+    std::string m_inputFileName;
+    size_t m_resumeOffset = 0;
+    size_t m_size = 0;
+    uint32_t m_headHash = 0;
+    uint32_t m_tailHash = 0;
+
+    /**
+     * Hashes the first bytes of a file.
+     */
+    static uint32_t hashHead(const MappedFile& t_file, size_t t_size) {
+        return ItemTable::hash(StringView(t_file.data(), std::min(t_size, FINGERPRINT_SIZE)));
+    }
+
+    /**
+     * Hashes the bytes that end at a given size.
+     */
+    static uint32_t hashTail(const MappedFile& t_file, size_t t_size) {
+        size_t length = std::min(t_size, FINGERPRINT_SIZE);
+        return ItemTable::hash(StringView(t_file.data() + t_size - length, length));
+    }
+
+public:
+    /**
+     * Captures a checkpoint after the first bytes of a file have been counted.
+     * Counting resumes at the start of a trailing item that is not followed by
+     * whitespace, because an append may continue that item.
+     *
+     * @param t_inputFileName the name of the counted file
+     * @param t_file the counted file
+     * @param t_size the number of bytes that were counted
+     * @return the checkpoint
+     */
+    static IngestCheckpoint capture(const std::string& t_inputFileName, const MappedFile& t_file, size_t t_size) {
+        IngestCheckpoint checkpoint;
+        checkpoint.m_inputFileName = t_inputFileName;
+        checkpoint.m_size = t_size;
+        checkpoint.m_resumeOffset = t_size;
+        while (checkpoint.m_resumeOffset > 0 && !Utils::isWhitespace(t_file.data()[checkpoint.m_resumeOffset - 1])) {
+            checkpoint.m_resumeOffset--;
+        }
+        checkpoint.m_headHash = hashHead(t_file, checkpoint.m_size);
+        checkpoint.m_tailHash = hashTail(t_file, checkpoint.m_size);
+        return checkpoint;
+    }
+
+    /**
+     * Loads a checkpoint file.
+     *
+     * @param t_fileName the name of the checkpoint file
+     * @return true if the checkpoint was read successfully, false otherwise
+     */
+    bool load(const std::string& t_fileName) {
+        std::ifstream checkpointFile(t_fileName);
+        std::string key;
+        int fieldsRead = 0;
+        while (checkpointFile >> key) {
+            if (key == "input") {
+                std::getline(checkpointFile >> std::ws, m_inputFileName);
+            } else if (key == "resume") {
+                checkpointFile >> m_resumeOffset;
+            } else if (key == "size") {
+                checkpointFile >> m_size;
+            } else if (key == "head") {
+                checkpointFile >> m_headHash;
+            } else if (key == "tail") {
+                checkpointFile >> m_tailHash;
+            } else {
+                return false;
+            }
+            if (!checkpointFile) {
+                return false;
+            }
+            fieldsRead++;
+        }
+        return fieldsRead == 5 && m_resumeOffset <= m_size;
+    }
+
+    /**
+     * Saves the checkpoint, replacing the checkpoint file atomically.
+     *
+     * @param t_fileName the name of the checkpoint file
+     * @return true if the checkpoint was written successfully, false otherwise
+     */
+    bool save(const std::string& t_fileName) const {
+        BufferedWriter checkpointFile;
+        if (!checkpointFile.open(t_fileName)) {
+            return false;
+        }
+        checkpointFile.write("input ");
+        checkpointFile.write(m_inputFileName);
+        checkpointFile.write("\nresume ");
+        checkpointFile.writeNumber(static_cast<long long>(m_resumeOffset));
+        checkpointFile.write("\nsize ");
+        checkpointFile.writeNumber(static_cast<long long>(m_size));
+        checkpointFile.write("\nhead ");
+        checkpointFile.writeNumber(m_headHash);
+        checkpointFile.write("\ntail ");
+        checkpointFile.writeNumber(m_tailHash);
+        checkpointFile.write('\n');
+        return checkpointFile.commit();
+    }
+
+    /**
+     * Checks if a file is the checkpointed file with zero or more bytes appended.
+     *
+     * @param t_inputFileName the name of the file
+     * @param t_file the file
+     * @return true if counting can resume at getResumeOffset(), false otherwise
+     */
+    bool matches(const std::string& t_inputFileName, const MappedFile& t_file) const {
+        return t_inputFileName == m_inputFileName && t_file.size() >= m_size && m_size > 0 &&
+               hashHead(t_file, m_size) == m_headHash && hashTail(t_file, m_size) == m_tailHash;
+    }
+
+    /**
+     * Gets the size of the file when the checkpoint was taken.
+     *
+     * @return the size in bytes
+     */
+    size_t getSize() const {
+        return m_size;
+    }
+
+    /**
+     * Gets the offset at which counting resumes.
+     *
+     * @return the byte offset
+     */
+    size_t getResumeOffset() const {
+        return m_resumeOffset;
+    }
+
+    /**
+     * Gets the item that was counted at the end of the file but may be continued by an append.
+     *
+     * @param t_file the checkpointed file
+     * @return view of the trailing item, empty if the file ended with whitespace
+     */
+    StringView getPendingItem(const MappedFile& t_file) const {
+        return StringView(t_file.data() + m_resumeOffset, m_size - m_resumeOffset);
+    }
+};
+
+const size_t IngestCheckpoint::FINGERPRINT_SIZE;
+
+/**
+ * Binary snapshot of the item counts that loads without tokenizing.
+ * Layout, in native byte order:
+ *   header   magic "CGSNAPSH", version, byte order mark, item count, string bytes, checksum
+ *   offsets  uint32 per item plus one, the start of each name in the string table
+ *   counts   int32 per item
+ *   strings  the names back to back
+ * The checksum is 64 bit FNV-1a over everything after the header. The file is
+ * memory mapped on load and the arrays are read in place.
+ */
+class DatabaseSnapshot {
+private:
+    static const uint32_t VERSION = 1;
+    static const uint32_t BYTE_ORDER_MARK = 0x01020304u;
+
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t byteOrderMark;
+        uint32_t itemCount;
+        uint32_t reserved;
+        uint64_t stringBytes;
+        uint64_t checksum;
+    };
+
+    /**
+     * Continues a 64 bit FNV-1a hash over a range of bytes.
+     */
+    static uint64_t hashBytes(const char* t_data, size_t t_length, uint64_t t_hash = 14695981039346656037ULL) {
+        for (size_t i = 0; i < t_length; i++) {
+            t_hash ^= static_cast<unsigned char>(t_data[i]);
+            t_hash *= 1099511628211ULL;
+        }
+        return t_hash;
+    }
+
+public:
+    /**
+     * Writes a snapshot, replacing the snapshot file atomically.
+     *
+     * @param t_fileName the name of the snapshot file
+     * @param t_counts the table to save
+     * @param t_order the ids to save, in the order they will be loaded
+     * @return true if the snapshot was written successfully, false otherwise
+     */
+    static bool save(const std::string& t_fileName, const ItemTable& t_counts, const std::vector<ItemTable::ItemId>& t_order) {
+        // Build the arrays first so the checksum can go in the header
+        std::vector<uint32_t> offsets;
+        std::vector<int32_t> counts;
+        offsets.reserve(t_order.size() + 1);
+        counts.reserve(t_order.size());
+        uint64_t stringBytes = 0;
+        for (ItemTable::ItemId id : t_order) {
+            offsets.push_back(static_cast<uint32_t>(stringBytes));
+            counts.push_back(t_counts.count(id));
+            stringBytes += t_counts.name(id).size();
+        }
+        if (stringBytes > 0xFFFFFFFFu) {
+            return false;
+        }
+        offsets.push_back(static_cast<uint32_t>(stringBytes));
+
+        const char* offsetBytes = reinterpret_cast<const char*>(offsets.data());
+        const char* countBytes = reinterpret_cast<const char*>(counts.data());
+        uint64_t checksum = hashBytes(offsetBytes, offsets.size() * sizeof(uint32_t));
+        checksum = hashBytes(countBytes, counts.size() * sizeof(int32_t), checksum);
+        for (ItemTable::ItemId id : t_order) {
+            checksum = hashBytes(t_counts.name(id).data(), t_counts.name(id).size(), checksum);
+        }
+
+        Header header;
+        std::memcpy(header.magic, "CGSNAPSH", sizeof(header.magic));
+        header.version = VERSION;
+        header.byteOrderMark = BYTE_ORDER_MARK;
+        header.itemCount = static_cast<uint32_t>(t_order.size());
+        header.reserved = 0;
+        header.stringBytes = stringBytes;
+        header.checksum = checksum;
+
+        BufferedWriter snapshotFile;
+        if (!snapshotFile.open(t_fileName)) {
+            return false;
+        }
+        snapshotFile.write(StringView(reinterpret_cast<const char*>(&header), sizeof(header)));
+        snapshotFile.write(StringView(offsetBytes, offsets.size() * sizeof(uint32_t)));
+        snapshotFile.write(StringView(countBytes, counts.size() * sizeof(int32_t)));
+        for (ItemTable::ItemId id : t_order) {
+            snapshotFile.write(t_counts.name(id));
+        }
+        return snapshotFile.commit();
+    }
+
+    /**
+     * Loads a snapshot into a table.
+     *
+     * @param t_fileName the name of the snapshot file
+     * @param t_counts the table to load the counts into
+     * @return true if the snapshot is valid and was loaded, false otherwise
+     */
+    static bool load(const std::string& t_fileName, ItemTable& t_counts) {
+        MappedFile snapshotFile;
+        if (!snapshotFile.open(t_fileName) || snapshotFile.size() < sizeof(Header)) {
+            return false;
+        }
+
+        // Validate the header and that the arrays fit in the file
+        Header header;
+        std::memcpy(&header, snapshotFile.data(), sizeof(header));
+        if (std::memcmp(header.magic, "CGSNAPSH", sizeof(header.magic)) != 0 || header.version != VERSION || header.byteOrderMark != BYTE_ORDER_MARK) {
+            return false;
+        }
+        uint64_t arrayBytes = (static_cast<uint64_t>(header.itemCount) + 1) * sizeof(uint32_t) + static_cast<uint64_t>(header.itemCount) * sizeof(int32_t);
+        if (snapshotFile.size() - sizeof(Header) != arrayBytes + header.stringBytes) {
+            return false;
+        }
+        const char* payload = snapshotFile.data() + sizeof(Header);
+        if (hashBytes(payload, snapshotFile.size() - sizeof(Header)) != header.checksum) {
+            return false;
+        }
+
+        // The header is a multiple of 8 bytes, so the arrays are aligned in the mapping
+        const uint32_t* offsets = reinterpret_cast<const uint32_t*>(payload);
+        const int32_t* counts = reinterpret_cast<const int32_t*>(offsets + header.itemCount + 1);
+        const char* strings = reinterpret_cast<const char*>(counts + header.itemCount);
+        if (offsets[header.itemCount] != header.stringBytes) {
+            return false;
+        }
+        for (uint32_t i = 0; i < header.itemCount; i++) {
+            if (offsets[i] > offsets[i + 1]) {
+                return false;
+            }
+            t_counts.add(StringView(strings + offsets[i], offsets[i + 1] - offsets[i]), counts[i]);
+        }
+        return true;
+    }
+};
+
+/**
+ * Database class that stores item counts and provides methods to search and display the data.
+ */
+class Database {
+public:
+    class DatabaseError : public std::runtime_error {
+    public:
+        explicit DatabaseError(const std::string& message) : std::runtime_error(message) {}
+    };
+
+private:
+    ItemTable m_itemCounts;
+    CountIndex m_countIndex;
+    int m_maxItemCount = 0;
+
+    // Incremented on every mutation; sorted views are cached against it
+    size_t m_version = 0;
+    mutable std::vector<ItemTable::ItemId> m_itemsByName;
+    mutable size_t m_itemsByNameVersion = 0;
+    mutable std::vector<ItemTable::ItemId> m_itemsByCount;
+    mutable size_t m_itemsByCountVersion = 0;
+    mutable SearchIndex m_searchIndex;
+    mutable size_t m_searchIndexVersion = 0;
+    mutable HeatMap m_heatMap;
+    mutable size_t m_heatMapVersion = 0;
+    mutable std::vector<ItemTable::ItemId> m_heatMapChangedIds;  // to classify again before using m_heatMap
+
+    // Per hour and per day counts when lines start with a timestamp, and the last window asked for
+    bool m_timestamps = false;
+    TimeBuckets m_hourBuckets;
+    TimeBuckets m_dayBuckets;
+    mutable TimeWindow m_recentWindow;
+    mutable bool m_recentWindowInDays = false;
+
+    // Counts of each input file when several stores or registers are read and kept apart
+    bool m_keepStoreCounts = false;
+    std::vector<std::string> m_storeNames;
+    std::vector<ItemTable> m_storeCounts;
+
+    // Sketches used instead of exact counting; the item table then holds only the heavy hitters
+    bool m_approximate = false;
+    ApproximateCounter m_approximateCounts;
+
+    // Where progress messages go; colors and progress bars are only drawn on std::cout
+    std::ostream* m_statusStream = &std::cout;
+
+    // Position in the input file the counts were built up to, saved with the backup
+    IngestCheckpoint m_checkpoint;
+    bool m_hasCheckpoint = false;
+
+    /**
+     * Records the items an update is about to change, so the heat map can classify only those
+     * again. Must be followed by finishUpdate(). A heat map that is already out of date, or a
+     * list that outgrows the items, is classified again in full instead.
+     *
+     * @param t_changedIds the ids of the items whose counts change, including new ones
+     */
+    void markHeatMapChanges(const std::vector<ItemTable::ItemId>& t_changedIds) {
+        if (m_heatMapVersion != m_version || m_heatMapChangedIds.size() + t_changedIds.size() > m_itemCounts.size()) {
+            m_heatMapChangedIds.clear();
+            return;
+        }
+        m_heatMapChangedIds.insert(m_heatMapChangedIds.end(), t_changedIds.begin(), t_changedIds.end());
+        m_heatMapVersion = m_version + 1;
+    }
+
+    /**
+     * Recomputes the values derived from the counts after they change and invalidates cached views.
+     *
+     * @param t_reindex true to reorder the count index from scratch, false if it was kept up to date
+     */
+    void finishUpdate(bool t_reindex = true) {
+        if (t_reindex) {
+            m_countIndex.rebuild(m_itemCounts);
+        }
+        m_maxItemCount = m_countIndex.maxCount(m_itemCounts);
+        m_version++;
+    }
+
+    /**
+     * Commits the counts staged in the hour buckets and rolls them up into the day buckets.
+     *
+     * @param t_incremental true to update the recent window with the changes, false to recompute it when next used
+     */
+    void commitTimeBuckets(bool t_incremental) {
+        std::vector<TimeBuckets::Change> hourChanges = m_hourBuckets.commit();
+        for (const TimeBuckets::Change& change : hourChanges) {
+            m_dayBuckets.add(change.period / 24, change.id, change.amount);
+        }
+        std::vector<TimeBuckets::Change> dayChanges = m_dayBuckets.commit();
+        if (t_incremental) {
+            m_recentWindow.apply(m_recentWindowInDays ? dayChanges : hourChanges);
+        } else {
+            m_recentWindow.reset(m_recentWindow.getLength());
+        }
+    }
+
+    /**
+     * Sets the console text color for progress messages.
+     *
+     * @param t_color the color to set
+     */
+    void setStatusColor(ConsoleColor t_color) {
+        if (m_statusStream == &std::cout) {
+            Utils::setConsoleTextColor(t_color);
+        }
+    }
+
+    /**
+     * Gets the name of the checkpoint file kept next to a backup file.
+     *
+     * @param t_backupFileName the name of the backup file
+     * @return the name of the checkpoint file
+     */
+    static std::string getCheckpointFileName(const std::string& t_backupFileName) {
+        return t_backupFileName + ".checkpoint";
+    }
+
+    /**
+     * Gets the name of the binary snapshot file kept next to a backup file.
+     *
+     * @param t_backupFileName the name of the backup file
+     * @return the name of the snapshot file
+     */
+    static std::string getSnapshotFileName(const std::string& t_backupFileName) {
+        return t_backupFileName + ".snapshot";
+    }
+
+    /**
+     * Reads a backup file written by writeDatabaseBackup.
+     *
+     * @param t_backupFileName the name of the backup file
+     * @param t_counts the table to load the counts into
+     * @return true if every line was read successfully, false otherwise
+     */
+    static bool tryLoadBackup(const std::string& t_backupFileName, ItemTable& t_counts) {
+        MappedFile backupFile;
+        if (!backupFile.open(t_backupFileName)) {
+            return false;
+        }
+        const char* cursor = backupFile.data();
+        const char* end = cursor + backupFile.size();
+        while (cursor < end) {
+            // Each line is the item name, a space and the count
+            const char* lineEnd = static_cast<const char*>(std::memchr(cursor, '\n', end - cursor));
+            if (lineEnd == nullptr) {
+                lineEnd = end;
+            }
+            const char* separator = lineEnd;
+            while (separator > cursor && *(separator - 1) != ' ') {
+                separator--;
+            }
+            if (separator - cursor < 2 || separator == lineEnd) {
+                return false;
+            }
+            long long count = 0;
+            for (const char* digit = separator; digit < lineEnd; digit++) {
+                if (*digit < '0' || *digit > '9' || count > 2147483647LL / 10) {
+                    return false;
+                }
+                count = count * 10 + (*digit - '0');
+            }
+            t_counts.add(StringView(cursor, separator - 1 - cursor), static_cast<int>(count));
+            cursor = lineEnd + 1;
+        }
+        return true;
+    }
+
+    /**
+     * Tries to restore the counts saved with a backup so only newly appended input needs counting.
+     *
+     * @param t_inputFileName the name of the input file
+     * @param t_inputFile the input file
+     * @param t_backupFileName the name of the backup file
+     * @return the offset to resume counting at, 0 if the input must be counted from the start
+     */
+    size_t tryResumeFromBackup(const std::string& t_inputFileName, const MappedFile& t_inputFile, const std::string& t_backupFileName) {
+        IngestCheckpoint checkpoint;
+        if (!checkpoint.load(getCheckpointFileName(t_backupFileName)) || !checkpoint.matches(t_inputFileName, t_inputFile)) {
+            return 0;
+        }
+        // Prefer the binary snapshot and fall back to parsing the text backup
+        ItemTable savedCounts;
+        if (!DatabaseSnapshot::load(getSnapshotFileName(t_backupFileName), savedCounts)) {
+            savedCounts = ItemTable();
+            if (!tryLoadBackup(t_backupFileName, savedCounts)) {
+                return 0;
+            }
+        }
+
+        // The trailing item is recounted from the resume offset in case the append continued it
+        StringView pendingItem = checkpoint.getPendingItem(t_inputFile);
+        if (!pendingItem.empty()) {
+            ItemTable::ItemId id = savedCounts.find(pendingItem);
+            if (id == ItemTable::NOT_FOUND || savedCounts.count(id) < 2) {
+                return 0;
+            }
+            savedCounts.add(pendingItem, -1);
+        }
+        m_itemCounts = std::move(savedCounts);
+        return checkpoint.getResumeOffset();
+    }
+
+    /**
+     * Maps an input file and reports whether it could be opened.
+     *
+     * @param t_fileName the name of the file to map
+     * @param t_mappedFile the mapping to open
+     * @return true if the file was mapped successfully, false otherwise
+     */
+    bool tryMapInputFile(const std::string& t_fileName, MappedFile& t_mappedFile) {
+        *m_statusStream << "Opening " << t_fileName << " for input...";
+        if (!t_mappedFile.open(t_fileName)) {
+            *m_statusStream << "ERROR" << std::endl << "Please make sure the file exists in the same directory as the program." << std::endl;
+            return false;
+        }
+        *m_statusStream << "OK" << std::endl;
+        return true;
+    }
+
+    /**
+     * Opens the output file writer and reports whether it could be created.
+     *
+     * @param t_fileName the name of the file to write
+     * @param t_writer the writer to open
+     * @return true if the file was created successfully, false otherwise
+     */
+    bool tryOpenOutputFile(const std::string& t_fileName, BufferedWriter& t_writer) {
+        *m_statusStream << "Opening " << t_fileName << " for output...";
+        if (!t_writer.open(t_fileName)) {
+            *m_statusStream << "ERROR" << std::endl << "Please make sure the program has permission to create the file in the same directory as the program." << std::endl;
+            return false;
+        }
+        *m_statusStream << "OK" << std::endl;
+        return true;
+    }
+
+    /**
+     * Counts the whitespace separated items in a range of bytes.
+     * Tokens are looked up in place, so a key is only allocated the first time
+     * a distinct item is inserted into the table.
+     *
+     * @param t_begin the first byte of the range
+     * @param t_end one past the last byte of the range
+     * @param t_counts the table to add the counts to
+     * @param t_onProgress called with the number of bytes consumed after each item
+     * @return true if at least one item was found, false otherwise
+     */
+    template <typename ProgressCallback>
+    static bool countItems(const char* t_begin, const char* t_end, ItemTable& t_counts, ProgressCallback t_onProgress) {
+        bool foundItem = false;
+        TokenScanner::forEachToken(t_begin, t_end, [&](const char* t_itemStart, const char* t_itemEnd) {
+            foundItem = true;
+
+            // Update the item count
+            t_counts.add(StringView(t_itemStart, t_itemEnd - t_itemStart));
+
+            t_onProgress(static_cast<size_t>(t_itemEnd - t_begin));
+        });
+        return foundItem;
+    }
+
+    /**
+     * Counts the items in a range of bytes whose lines may start with a timestamp.
+     * The first token of a line is taken as the time of the items after it on that line when
+     * Utils::tryParseTimestamp() accepts it; otherwise it is an item and the line has no time.
+     * Items with a time are also added to the hour bucket they fall in.
+     *
+     * @param t_begin the first byte of the range, at the start of a line
+     * @param t_end one past the last byte of the range
+     * @param t_counts the table to add the counts to
+     * @param t_hourBuckets the buckets to add the timed counts to
+     * @param t_amount the amount to add per sighting, -1 to take back an earlier count
+     * @param t_onProgress called with the number of bytes consumed after each item
+     * @return true if at least one item was found, false otherwise
+     */
+    template <typename ProgressCallback>
+    static bool countTimestampedItems(const char* t_begin, const char* t_end, ItemTable& t_counts, TimeBuckets& t_hourBuckets, int t_amount, ProgressCallback t_onProgress) {
+        bool foundItem = false;
+        const char* previousEnd = t_begin;
+        bool atLineStart = true;
+        long long hour = -1;
+        TokenScanner::forEachToken(t_begin, t_end, [&](const char* t_tokenStart, const char* t_tokenEnd) {
+            // A new line starts if the whitespace since the last token holds a line break
+            size_t gap = static_cast<size_t>(t_tokenStart - previousEnd);
+            atLineStart = atLineStart || std::memchr(previousEnd, '\n', gap) != nullptr;
+            previousEnd = t_tokenEnd;
+
+            // The optional time column
+            if (atLineStart) {
+                atLineStart = false;
+                long long seconds;
+                if (Utils::tryParseTimestamp(t_tokenStart, t_tokenEnd - t_tokenStart, seconds)) {
+                    hour = seconds / 3600;
+                    return;
+                }
+                hour = -1;
+            }
+            foundItem = true;
+
+            StringView item(t_tokenStart, t_tokenEnd - t_tokenStart);
+            ItemTable::ItemId id = t_counts.intern(item, ItemTable::hash(item));
+            t_counts.addToCount(id, t_amount);
+            if (hour >= 0) {
+                t_hourBuckets.add(hour, id, t_amount);
+            }
+            t_onProgress(static_cast<size_t>(t_tokenEnd - t_begin));
+        });
+        return foundItem;
+    }
+
+    /**
+     * Counts the items in a range of bytes into the approximate counter.
+     *
+     * @param t_begin the first byte of the range
+     * @param t_end one past the last byte of the range
+     * @param t_counts the counter to add the sightings to
+     * @param t_onProgress called with the number of bytes consumed after each item
+     * @return true if at least one item was found, false otherwise
+     */
+    template <typename ProgressCallback>
+    static bool countApproximateItems(const char* t_begin, const char* t_end, ApproximateCounter& t_counts, ProgressCallback t_onProgress) {
+        bool foundItem = false;
+        TokenScanner::forEachToken(t_begin, t_end, [&](const char* t_itemStart, const char* t_itemEnd) {
+            foundItem = true;
+            t_counts.add(StringView(t_itemStart, t_itemEnd - t_itemStart));
+            t_onProgress(static_cast<size_t>(t_itemEnd - t_begin));
+        });
+        return foundItem;
+    }
+
+    /**
+     * Replaces the item table with the heavy hitters of the approximate counter and reports its size.
+     * Best sellers tracked from their first sighting keep their exact count; the others keep the
+     * highest their count can be, like the sketch estimates of the rest.
+     */
+    void loadHeavyHitters() {
+        m_itemCounts = ItemTable();
+        size_t exactItems = 0;
+        m_approximateCounts.getHeavyHitters().forEach([this, &exactItems](StringView t_name, long long t_count, long long t_error) {
+            m_itemCounts.add(t_name, static_cast<int>(std::min<long long>(t_count + t_error, INT_MAX)));
+            exactItems += t_error == 0 ? 1 : 0;
+        });
+        *m_statusStream << "Approximate counts: about " << m_approximateCounts.estimateDistinctItems() << " distinct items, "
+                        << m_itemCounts.size() << " best sellers kept (" << exactItems << " exact), "
+                        << m_approximateCounts.memoryUsage() << " bytes" << std::endl;
+    }
+
+    /**
+     * Reads up to a chunk of bytes from a file descriptor, returning as soon as any are available.
+     *
+     * @param t_fd the descriptor to read from
+     * @param t_buffer where to store the bytes
+     * @param t_size the most bytes to read
+     * @return the number of bytes read, 0 at end of input, -1 on error
+     */
+    static long long readChunk(int t_fd, char* t_buffer, size_t t_size) {
+        while (true) {
+        #ifdef _WIN32
+            long long bytesRead = _read(t_fd, t_buffer, static_cast<unsigned int>(std::min<size_t>(t_size, 1u << 30)));
+        #else
+            long long bytesRead = read(t_fd, t_buffer, t_size);
+            if (bytesRead < 0 && errno == EINTR) {
+                continue;
+            }
+        #endif
+            return bytesRead;
+        }
+    }
+
+    /**
+     * Counts the items in a stream using a fixed size buffer.
+     * Only the bytes up to the last whitespace in the buffer are counted; an item cut
+     * off by the end of a chunk is moved to the front and completed by the next read.
+     *
+     * @param t_fd the descriptor to read from
+     * @param t_inputFileName the name of the input for error messages
+     * @return true if at least one item was found, false otherwise
+     * @throws DatabaseError if the stream cannot be read
+     */
+    bool countItemsFromStream(int t_fd, const std::string& t_inputFileName) {
+        std::vector<char> buffer(1 << 20);
+        size_t carried = 0;
+        size_t totalBytes = 0;
+        bool foundItem = false;
+        auto countChunk = [this](const char* t_begin, const char* t_end) {
+            auto ignoreProgress = [](size_t) {};
+            if (m_approximate) {
+                return countApproximateItems(t_begin, t_end, m_approximateCounts, ignoreProgress);
+            }
+            if (m_timestamps) {
+                return countTimestampedItems(t_begin, t_end, m_itemCounts, m_hourBuckets, 1, ignoreProgress);
+            }
+            return countItems(t_begin, t_end, m_itemCounts, ignoreProgress);
+        };
+        while (true) {
+            // Only an item longer than the whole buffer makes it grow
+            if (carried == buffer.size()) {
+                buffer.resize(buffer.size() * 2);
+            }
+            long long bytesRead = readChunk(t_fd, buffer.data() + carried, buffer.size() - carried);
+            if (bytesRead < 0) {
+                throw DatabaseError("Failed to read input: " + t_inputFileName);
+            }
+            if (bytesRead == 0) {
+                break;
+            }
+            totalBytes += static_cast<size_t>(bytesRead);
+            size_t filled = carried + static_cast<size_t>(bytesRead);
+            size_t complete = filled;
+
+            // Timestamped input is cut on whole lines so every chunk starts with the line's time
+            while (complete > 0 && (m_timestamps ? buffer[complete - 1] != '\n' : !Utils::isWhitespace(buffer[complete - 1]))) {
+                complete--;
+            }
+            foundItem = countChunk(buffer.data(), buffer.data() + complete) || foundItem;
+            carried = filled - complete;
+            std::memmove(buffer.data(), buffer.data() + complete, carried);
+        }
+
+        // The last item does not need whitespace after it
+        foundItem = countChunk(buffer.data(), buffer.data() + carried) || foundItem;
+        *m_statusStream << "Read " << totalBytes << " bytes" << std::endl;
+        Instrumentation::addIngestedBytes(totalBytes);
+        return foundItem;
+    }
+
+    /**
+     * Splits a buffer into ranges of roughly equal size that start and end on line boundaries.
+     *
+     * @param t_begin the first byte of the buffer
+     * @param t_end one past the last byte of the buffer
+     * @param t_rangeCount the number of ranges wanted
+     * @return the range boundaries, the first is t_begin and the last is t_end
+     */
+    static std::vector<const char*> splitOnLineBoundaries(const char* t_begin, const char* t_end, unsigned int t_rangeCount) {
+        std::vector<const char*> boundaries;
+        boundaries.push_back(t_begin);
+        size_t rangeSize = (t_end - t_begin) / t_rangeCount;
+        for (unsigned int i = 1; i < t_rangeCount; i++) {
+            // Move the split point forward to just past the next newline
+            const char* split = t_begin + rangeSize * i;
+            if (split < boundaries.back()) {
+                split = boundaries.back();
+            }
+            while (split < t_end && *split != '\n') {
+                ++split;
+            }
+            if (split < t_end) {
+                ++split;
+            }
+            boundaries.push_back(split);
+        }
+        boundaries.push_back(t_end);
+        return boundaries;
+    }
+
+    /**
+     * Counts a buffer on several threads, each into its own hash table, then merges the tables.
+     *
+     * @param t_begin the first byte of the buffer
+     * @param t_end one past the last byte of the buffer
+     * @param t_threadCount the number of worker threads
+     * @return true if at least one item was found, false otherwise
+     */
+    bool countItemsInParallel(const char* t_begin, const char* t_end, unsigned int t_threadCount) {
+        // Workers publish progress in coarse steps to keep the shared counter off the hot path
+        const size_t publishStep = 1 << 20;
+        std::vector<const char*> boundaries = splitOnLineBoundaries(t_begin, t_end, t_threadCount);
+        std::vector<ItemTable> shardCounts(t_threadCount);
+        std::vector<char> shardFoundItem(t_threadCount, 0);
+        std::atomic<size_t> bytesDone(0);
+        std::atomic<unsigned int> shardsDone(0);
+
+        std::vector<std::thread> workers;
+        for (unsigned int i = 0; i < t_threadCount; i++) {
+            workers.emplace_back([&, i]() {
+                size_t published = 0;
+                shardFoundItem[i] = countItems(boundaries[i], boundaries[i + 1], shardCounts[i], [&](size_t t_consumed) {
+                    if (t_consumed - published >= publishStep) {
+                        bytesDone += t_consumed - published;
+                        published = t_consumed;
+                    }
+                });
+                bytesDone += (boundaries[i + 1] - boundaries[i]) - published;
+                shardsDone++;
+            });
+        }
+
+        // The calling thread drives the progress bar while the workers count
+        ProgressReporter progress(t_end - t_begin, m_statusStream == &std::cout);
+        while (shardsDone.load() < t_threadCount) {
+            progress.update(bytesDone.load());
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        progress.finish();
+
+        // Merge the partial tables
+        bool foundItem = false;
+        for (unsigned int i = 0; i < t_threadCount; i++) {
+            foundItem = foundItem || shardFoundItem[i];
+            m_itemCounts.merge(shardCounts[i]);
+            shardCounts[i] = ItemTable();
+        }
+        return foundItem;
+    }
+
+    /**
+     * Adds up the counts of every item counted so far.
+     *
+     * @return the number of item sightings, including those the approximate counter did not keep
+     */
+    long long countSightings() const {
+        if (m_approximate) {
+            return m_approximateCounts.getSightings();
+        }
+        long long total = 0;
+        for (ItemTable::ItemId id = 0; id < m_itemCounts.size(); id++) {
+            total += m_itemCounts.count(id);
+        }
+        return total;
+    }
+
+    /**
+     * Reduces partial tables into one by merging them in pairs, each round on parallel threads.
+     * Every round halves the number of tables, so the distinct items are merged in
+     * logarithmically many rounds instead of one after another into a single table.
+     *
+     * @param t_tables the tables to reduce, at least one, emptied by the reduction
+     * @param t_threadCount the most merges to run at once
+     * @return the merged table
+     */
+    static ItemTable reduceTables(std::vector<ItemTable>& t_tables, unsigned int t_threadCount) {
+        for (size_t step = 1; step < t_tables.size(); step *= 2) {
+            // Table i absorbs table i + step for every i that is a multiple of twice the step
+            size_t pairCount = (t_tables.size() - step + step * 2 - 1) / (step * 2);
+            std::atomic<size_t> nextPair(0);
+            std::vector<std::thread> mergers;
+            for (size_t i = 0; i < std::min<size_t>(pairCount, t_threadCount); i++) {
+                mergers.emplace_back([&t_tables, &nextPair, pairCount, step]() {
+                    for (size_t pair = nextPair++; pair < pairCount; pair = nextPair++) {
+                        size_t target = pair * step * 2;
+                        t_tables[target].merge(t_tables[target + step]);
+                        t_tables[target + step] = ItemTable();
+                    }
+                });
+            }
+            for (auto& merger : mergers) {
+                merger.join();
+            }
+        }
+        return std::move(t_tables.front());
+    }
+
+public:
+    /**
+     * Sets where progress messages are written.
+     * Colors and progress bars are only drawn when the stream is std::cout.
+     *
+     * @param t_statusStream the stream for progress messages
+     */
+    void setStatusStream(std::ostream& t_statusStream) {
+        m_statusStream = &t_statusStream;
+    }
+
+    /**
+     * Sets whether lines may start with a timestamp. Must be set before the database is built.
+     * Timestamped input is counted on one thread and never resumed from a backup.
+     *
+     * @param t_timestamps true to read the optional time column and keep per hour and per day counts
+     */
+    void setTimestamps(bool t_timestamps) {
+        m_timestamps = t_timestamps;
+    }
+
+    /**
+     * Sets whether buildDatabaseFromFiles() keeps the counts of each file as a store.
+     *
+     * @param t_keepStoreCounts true to keep a per store breakdown next to the totals
+     */
+    void setKeepStoreCounts(bool t_keepStoreCounts) {
+        m_keepStoreCounts = t_keepStoreCounts;
+    }
+
+    /**
+     * Switches to approximate counting in fixed memory. Must be set before the database is built.
+     * Only the best sellers are kept as items; other counts are estimated on lookup.
+     *
+     * @param t_error the most a count is overestimated by, as a fraction of all counted items
+     * @param t_failureRate the probability of exceeding the error bound
+     */
+    void setApproximate(double t_error, double t_failureRate) {
+        m_approximate = true;
+        m_approximateCounts.configure(t_error, t_failureRate);
+    }
+
+    /**
+     * Checks whether the counts are approximate.
+     *
+     * @return true if the database was built with setApproximate()
+     */
+    bool isApproximate() const {
+        return m_approximate;
+    }
+
+    /**
+     * Checks if an input should be read as a stream instead of memory mapped.
+     *
+     * @param t_inputFileName the name of the input, "-" for standard input
+     * @return true for standard input, pipes and character devices, false otherwise
+     */
+    static bool isStreamInput(const std::string& t_inputFileName) {
+        if (t_inputFileName == "-") {
+            return true;
+        }
+    #ifdef _WIN32
+        return false;
+    #else
+        struct stat fileInfo;
+        return stat(t_inputFileName.c_str(), &fileInfo) == 0 && (S_ISFIFO(fileInfo.st_mode) || S_ISCHR(fileInfo.st_mode));
+    #endif
+    }
+
+    /**
+     * Checks whether the database keeps per hour and per day counts.
+     *
+     * @return true if the input was read with timestamps
+     */
+    bool hasTimestamps() const {
+        return m_timestamps;
+    }
+
+    /**
+     * Builds the database from the input file.
+     * The file is memory mapped and scanned once. With more than one thread the
+     * file is split into ranges on line boundaries that are counted in parallel.
+     * When a backup file is given and its checkpoint shows the input has only been
+     * appended to since, the saved counts are loaded and only the new bytes are scanned.
+     *
+     * @param t_inputFileName the name of the input file
+     * @param t_threadCount the number of threads to count with, 0 uses one per core (optional, default is 1)
+     * @param t_backupFileName the backup to resume from, empty to always count the whole file (optional)
+     * @throws DatabaseError if the database cannot be built
+     */
+    void buildDatabaseFromFile(const std::string& t_inputFileName, unsigned int t_threadCount = 1, const std::string& t_backupFileName = "") {
+        setStatusColor(COLOR_BLUE);
+
+        // Pipes and standard input cannot be mapped, so they are read in chunks
+        if (isStreamInput(t_inputFileName)) {
+            buildDatabaseFromStream(t_inputFileName);
+            return;
+        }
+
+        ScopedTimer timer("ingest");
+
+        // Map the input file
+        MappedFile inputFile;
+        if (!tryMapInputFile(t_inputFileName, inputFile)) {
+            throw DatabaseError("Failed to open input file: " + t_inputFileName);
+        }
+
+        // Check if the file is empty
+        if (inputFile.size() == 0) {
+            throw DatabaseError("Input file is empty");
+        }
+
+        // Skip the part of the file that the saved backup already covers; the backup has no
+        // time buckets or sketches, so timestamped and approximate input is always counted in full
+        size_t resumeOffset = 0;
+        if (!t_backupFileName.empty() && m_itemCounts.size() == 0 && !m_timestamps && !m_approximate) {
+            resumeOffset = tryResumeFromBackup(t_inputFileName, inputFile, t_backupFileName);
+            if (resumeOffset > 0) {
+                *m_statusStream << "Resuming from " << t_backupFileName << " at byte " << resumeOffset << std::endl;
+            }
+        }
+        size_t byteCount = inputFile.size() - resumeOffset;
+        // Adding up the sightings walks every item, so it is only done for --stats
+        long long resumedSightings = Instrumentation::isEnabled() ? countSightings() : 0;
+
+        // Small files are not worth the thread start up cost
+        const size_t minBytesPerThread = 1 << 20;
+        if (t_threadCount == 0) {
+            t_threadCount = std::max(1u, std::thread::hardware_concurrency());
+        }
+        t_threadCount = static_cast<unsigned int>(std::min<size_t>(t_threadCount, std::max<size_t>(1, byteCount / minBytesPerThread)));
+        if (m_timestamps || m_approximate) {
+            t_threadCount = 1;
+        }
+
+        // Scan the file, store the item counts and show progress by byte offset
+        *m_statusStream << "Reading input file" << " (" << byteCount << " bytes";
+        if (t_threadCount > 1) {
+            *m_statusStream << ", " << t_threadCount << " threads";
+        }
+        *m_statusStream << ")" << std::endl;
+        const char* begin = inputFile.data() + resumeOffset;
+        const char* end = begin + byteCount;
+        bool foundItem = resumeOffset > 0;
+        if (t_threadCount > 1) {
+            foundItem = countItemsInParallel(begin, end, t_threadCount) || foundItem;
+        } else {
+            ProgressReporter progress(byteCount, m_statusStream == &std::cout);
+            auto onProgress = [&progress](size_t t_consumed) {
+                progress.update(t_consumed);
+            };
+            if (m_approximate) {
+                foundItem = countApproximateItems(begin, end, m_approximateCounts, onProgress) || foundItem;
+            } else if (m_timestamps) {
+                foundItem = countTimestampedItems(begin, end, m_itemCounts, m_hourBuckets, 1, onProgress) || foundItem;
+                commitTimeBuckets(false);
+            } else {
+                foundItem = countItems(begin, end, m_itemCounts, onProgress) || foundItem;
+            }
+            progress.finish();
+        }
+
+        // Check if the file contained only whitespace
+        if (!foundItem) {
+            throw DatabaseError("Input file is empty");
+        }
+
+        Instrumentation::addIngestedBytes(byteCount);
+        if (Instrumentation::isEnabled()) {
+            Instrumentation::addIngestedItems(countSightings() - resumedSightings);
+        }
+
+        // Approximate counts cover only the best sellers, so they are never resumed from
+        if (m_approximate) {
+            loadHeavyHitters();
+            m_hasCheckpoint = false;
+        } else {
+            m_checkpoint = IngestCheckpoint::capture(t_inputFileName, inputFile, inputFile.size());
+            m_hasCheckpoint = true;
+        }
+        finishUpdate();
+    }
+
+    /**
+     * Builds the database from several input files, such as the logs of each register or store.
+     * The files are mapped up front and counted on a pool of worker threads, each file into
+     * its own table, and the partial tables are then reduced into one by reduceTables().
+     * When per store counts are kept, or the input is timestamped, each file's table is
+     * merged into the totals in turn so its item ids can be translated. Several files
+     * cannot be resumed from a backup, so no checkpoint is kept.
+     *
+     * @param t_inputFileNames the names of the input files
+     * @param t_threadCount the number of worker threads, 0 uses one per core (optional, default is 1)
+     * @throws DatabaseError if a file cannot be opened or no file contains an item
+     */
+    void buildDatabaseFromFiles(const std::vector<std::string>& t_inputFileNames, unsigned int t_threadCount = 1) {
+        ScopedTimer timer("ingest");
+        setStatusColor(COLOR_BLUE);
+
+        // Map every file first so a missing one fails before any counting starts
+        size_t fileCount = t_inputFileNames.size();
+        std::vector<std::unique_ptr<MappedFile>> inputFiles;
+        size_t byteCount = 0;
+        for (const std::string& fileName : t_inputFileNames) {
+            if (isStreamInput(fileName)) {
+                throw DatabaseError("Pipes and standard input cannot be read per store or with other input files: " + fileName);
+            }
+            inputFiles.emplace_back(new MappedFile());
+            if (!tryMapInputFile(fileName, *inputFiles.back())) {
+                throw DatabaseError("Failed to open input file: " + fileName);
+            }
+            byteCount += inputFiles.back()->size();
+        }
+
+        if (t_threadCount == 0) {
+            t_threadCount = std::max(1u, std::thread::hardware_concurrency());
+        }
+        t_threadCount = static_cast<unsigned int>(std::max<size_t>(1, std::min<size_t>(t_threadCount, fileCount)));
+        if (m_approximate) {
+            t_threadCount = 1;
+        }
+        *m_statusStream << "Reading " << fileCount << " input files (" << byteCount << " bytes";
+        if (t_threadCount > 1) {
+            *m_statusStream << ", " << t_threadCount << " threads";
+        }
+        *m_statusStream << ")" << std::endl;
+
+        // Workers take the next file until all are counted and publish progress in coarse steps
+        const size_t publishStep = 1 << 20;
+        std::vector<ItemTable> fileCounts(fileCount);
+        std::vector<TimeBuckets> fileBuckets(m_timestamps ? fileCount : 0);
+        std::vector<char> fileFoundItem(fileCount, 0);
+        std::atomic<size_t> nextFile(0);
+        std::atomic<size_t> bytesDone(0);
+        std::atomic<unsigned int> workersDone(0);
+        std::vector<std::thread> workers;
+        for (unsigned int i = 0; i < t_threadCount; i++) {
+            workers.emplace_back([&]() {
+                for (size_t file = nextFile++; file < fileCount; file = nextFile++) {
+                    const char* begin = inputFiles[file]->data();
+                    const char* end = begin + inputFiles[file]->size();
+                    size_t published = 0;
+                    auto onProgress = [&](size_t t_consumed) {
+                        if (t_consumed - published >= publishStep) {
+                            bytesDone += t_consumed - published;
+                            published = t_consumed;
+                        }
+                    };
+                    if (m_approximate) {
+                        fileFoundItem[file] = countApproximateItems(begin, end, m_approximateCounts, onProgress);
+                    } else if (m_timestamps) {
+                        fileFoundItem[file] = countTimestampedItems(begin, end, fileCounts[file], fileBuckets[file], 1, onProgress);
+                        fileBuckets[file].commit();
+                    } else {
+                        fileFoundItem[file] = countItems(begin, end, fileCounts[file], onProgress);
+                    }
+                    bytesDone += inputFiles[file]->size() - published;
+
+                    // The counts are in the table now, so the mapping can go
+                    inputFiles[file]->close();
+                }
+                workersDone++;
+            });
+        }
+        ProgressReporter progress(byteCount, m_statusStream == &std::cout);
+        while (workersDone.load() < t_threadCount) {
+            progress.update(bytesDone.load());
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        progress.finish();
+
+        // Check if every file contained only whitespace
+        if (std::find(fileFoundItem.begin(), fileFoundItem.end(), 1) == fileFoundItem.end()) {
+            throw DatabaseError("Input files are empty");
+        }
+
+        // Combine the partial tables
+        m_hourBuckets.clear();
+        m_dayBuckets.clear();
+        m_storeNames.clear();
+        m_storeCounts.clear();
+        if (m_approximate) {
+            loadHeavyHitters();
+        } else if (m_keepStoreCounts || m_timestamps) {
+            m_itemCounts = ItemTable();
+            for (size_t file = 0; file < fileCount; file++) {
+                std::vector<ItemTable::ItemId> idMap;
+                m_itemCounts.merge(fileCounts[file], [&idMap](ItemTable::ItemId t_id) {
+                    idMap.push_back(t_id);
+                });
+                if (m_timestamps) {
+                    m_hourBuckets.add(fileBuckets[file], idMap);
+                    fileBuckets[file].clear();
+                }
+                if (m_keepStoreCounts) {
+                    m_storeNames.push_back(t_inputFileNames[file]);
+                    m_storeCounts.push_back(std::move(fileCounts[file]));
+                }
+            }
+            if (m_timestamps) {
+                commitTimeBuckets(false);
+            }
+        } else {
+            m_itemCounts = reduceTables(fileCounts, t_threadCount);
+        }
+        Instrumentation::addIngestedBytes(byteCount);
+        if (Instrumentation::isEnabled()) {
+            Instrumentation::addIngestedItems(countSightings());
+        }
+
+        m_hasCheckpoint = false;
+        finishUpdate();
+    }
+
+    /**
+     * Counts what was appended to the input file since it was last read.
+     * A file that was truncated or replaced is counted again from the start.
+     * Only complete lines are counted; a line still being written is counted
+     * once its newline arrives.
+     *
+     * @param t_inputFileName the name of the input file
+     * @return true if the counts changed, false if there was nothing new or the file could not be read
+     */
+    bool updateFromFile(const std::string& t_inputFileName) {
+        ScopedTimer timer("ingest update");
+        MappedFile inputFile;
+        if (!inputFile.open(t_inputFileName)) {
+            // The file may be between a rotation's rename and create
+            return false;
+        }
+        size_t completeSize = inputFile.size();
+        while (completeSize > 0 && inputFile.data()[completeSize - 1] != '\n') {
+            completeSize--;
+        }
+        bool reindex = true;
+        if (m_hasCheckpoint && m_checkpoint.matches(t_inputFileName, inputFile)) {
+            if (completeSize <= m_checkpoint.getSize()) {
+                return false;
+            }
+
+            // Updates stop at a newline, so only the checkpoint of the initial build can end inside an item.
+            // That trailing item is recounted from the resume offset in case the append continued it.
+            // Timestamped input recounts the whole trailing line, whose time is at its start.
+            ItemTable appended;
+            TimeBuckets appendedBuckets;
+            if (m_timestamps) {
+                size_t lineStart = m_checkpoint.getSize();
+                while (lineStart > 0 && inputFile.data()[lineStart - 1] != '\n') {
+                    lineStart--;
+                }
+                const char* line = inputFile.data() + lineStart;
+                countTimestampedItems(line, inputFile.data() + m_checkpoint.getSize(), appended, appendedBuckets, -1, [](size_t) {});
+                countTimestampedItems(line, inputFile.data() + completeSize, appended, appendedBuckets, 1, [](size_t) {});
+                appendedBuckets.commit();
+            } else {
+                StringView pendingItem = m_checkpoint.getPendingItem(inputFile);
+                if (!pendingItem.empty()) {
+                    appended.add(pendingItem, -1);
+                }
+                countItems(inputFile.data() + m_checkpoint.getResumeOffset(), inputFile.data() + completeSize, appended, [](size_t) {});
+            }
+
+            // A small append only moves the items it touched in the count index
+            reindex = appended.size() > m_itemCounts.size() / 8;
+            std::vector<ItemTable::ItemId> idMap;
+            m_itemCounts.merge(appended, [this, reindex, &idMap](ItemTable::ItemId t_id) {
+                idMap.push_back(t_id);
+                if (!reindex) {
+                    m_countIndex.update(t_id, m_itemCounts);
+                }
+            });
+            if (m_timestamps) {
+                m_hourBuckets.add(appendedBuckets, idMap);
+                commitTimeBuckets(true);
+            }
+            markHeatMapChanges(idMap);
+        } else {
+            m_itemCounts = ItemTable();
+            m_hourBuckets.clear();
+            m_dayBuckets.clear();
+            if (m_timestamps) {
+                countTimestampedItems(inputFile.data(), inputFile.data() + completeSize, m_itemCounts, m_hourBuckets, 1, [](size_t) {});
+                commitTimeBuckets(false);
+            } else {
+                countItems(inputFile.data(), inputFile.data() + completeSize, m_itemCounts, [](size_t) {});
+            }
+        }
+        m_checkpoint = IngestCheckpoint::capture(t_inputFileName, inputFile, completeSize);
+        m_hasCheckpoint = true;
+        finishUpdate(reindex);
+        return true;
+    }
+
+    /**
+     * Builds the database from standard input or a pipe, reading it in fixed size chunks.
+     * Memory use is bounded by the chunk buffer and the distinct items, so the input can be
+     * the output of another program such as zcat. The counts are only complete once the
+     * stream ends, so a stream that never ends, such as tail -F, is never reported on; a
+     * growing file is followed with --watch instead. Streams cannot be resumed, so no
+     * checkpoint is kept.
+     *
+     * @param t_inputFileName the name of the pipe, "-" for standard input
+     * @throws DatabaseError if the database cannot be built
+     */
+    void buildDatabaseFromStream(const std::string& t_inputFileName) {
+        ScopedTimer timer("ingest");
+        int fd = 0;
+        if (t_inputFileName == "-") {
+            *m_statusStream << "Reading standard input until it ends" << std::endl;
+        } else {
+            *m_statusStream << "Opening " << t_inputFileName << " for input...";
+        #ifdef _WIN32
+            fd = _open(t_inputFileName.c_str(), _O_RDONLY);
+        #else
+            fd = ::open(t_inputFileName.c_str(), O_RDONLY);
+        #endif
+            if (fd < 0) {
+                *m_statusStream << "ERROR" << std::endl;
+                throw DatabaseError("Failed to open input file: " + t_inputFileName);
+            }
+            *m_statusStream << "OK" << std::endl << "Reading " << t_inputFileName << " until it ends" << std::endl;
+        }
+
+        auto closeInput = [fd]() {
+            if (fd != 0) {
+            #ifdef _WIN32
+                _close(fd);
+            #else
+                ::close(fd);
+            #endif
+            }
+        };
+        bool foundItem;
+        try {
+            foundItem = countItemsFromStream(fd, t_inputFileName);
+        } catch (...) {
+            closeInput();
+            throw;
+        }
+        closeInput();
+        if (!foundItem) {
+            throw DatabaseError("Input file is empty");
+        }
+
+        m_hasCheckpoint = false;
+        if (m_timestamps) {
+            commitTimeBuckets(false);
+        }
+        if (m_approximate) {
+            loadHeavyHitters();
+        }
+        if (Instrumentation::isEnabled()) {
+            Instrumentation::addIngestedItems(countSightings());
+        }
+        finishUpdate();
+    }
+
+    /**
+     * Write database backup to file.
+     * The backup is written to a temporary file that replaces the output file once complete.
+     * A binary snapshot of the same counts and a checkpoint recording how much of the
+     * input they cover are saved next to it.
+     * 
+     * @throws DatabaseError if the database cannot be written
+     */
+    void writeDatabaseBackup(const std::string& t_outputFileName) {
+        ScopedTimer timer("backup");
+        setStatusColor(COLOR_YELLOW);
+
+        // Open the output file
+        BufferedWriter outputFile;
+        if (!tryOpenOutputFile(t_outputFileName, outputFile)) {
+            throw DatabaseError("Failed to open output file: " + t_outputFileName);
+        }
+
+        // A checkpoint left next to a replaced backup would describe the wrong counts
+        std::string checkpointFileName = getCheckpointFileName(t_outputFileName);
+        std::remove(checkpointFileName.c_str());
+
+        // Write the database to the output file line by line and show progress; items counted down to zero are left out
+        const std::vector<ItemTable::ItemId>& itemsByName = getItemsByName();
+        *m_statusStream << "Writing database backup" << " (" << itemsByName.size() << " lines)" << std::endl;
+        size_t currentLine = 0;
+        ProgressReporter progress(itemsByName.size(), m_statusStream == &std::cout);
+        for (ItemTable::ItemId id : itemsByName) {
+            outputFile.write(m_itemCounts.name(id));
+            outputFile.write(' ');
+            outputFile.writeNumber(m_itemCounts.count(id));
+            outputFile.write('\n');
+
+            currentLine++;
+            progress.update(currentLine);
+        }
+        progress.finish();
+
+        // Replace the previous backup only once the new one is complete
+        if (!outputFile.commit()) {
+            throw DatabaseError("Failed to write output file: " + t_outputFileName);
+        }
+
+        // The binary snapshot makes the next start faster; without it the text backup is parsed instead
+        std::string snapshotFileName = getSnapshotFileName(t_outputFileName);
+        if (!DatabaseSnapshot::save(snapshotFileName, m_itemCounts, itemsByName)) {
+            std::remove(snapshotFileName.c_str());
+            *m_statusStream << "Could not save " << snapshotFileName << std::endl;
+        }
+
+        // Failing to save the checkpoint only costs a full rebuild next time. Timestamped counts
+        // leave out the times a plain count sees as items, so a plain run must not resume from them
+        if (m_hasCheckpoint && !m_timestamps && !m_checkpoint.save(checkpointFileName)) {
+            *m_statusStream << "Could not save " << checkpointFileName << ", the next start will read the whole input file" << std::endl;
+        }
+    }
+
+    /**
+     * Tries to find an item by name.
+     *
+     * @param t_item the name of the item to find
+     * @param t_id the id of the item
+     * @return true if the item was found, false otherwise
+     */
+    bool tryFindItem(const std::string& t_item, ItemTable::ItemId& t_id) const {
+        ScopedTimer timer("lookup");
+
+        // Trim and validate the item without copying it
+        size_t start = 0;
+        size_t end = t_item.length();
+        while (start < end && Utils::isWhitespace(t_item[start])) {
+            start++;
+        }
+        while (end > start && Utils::isWhitespace(t_item[end - 1])) {
+            end--;
+        }
+        StringView item(t_item.data() + start, end - start);
+        if (item.empty()) {
+            return false;
+        }
+
+        // Try the item as entered (case-sensitive), then any casing through the normalized index
+        // Fixes issue #1: "Item not found" when searching for APPLES
+        ItemTable::ItemId id = m_itemCounts.find(item);
+        if (id == ItemTable::NOT_FOUND) {
+            id = m_itemCounts.findFolded(item);
+            if (id == ItemTable::NOT_FOUND) {
+                return false;
+            }
+        }
+        if (m_itemCounts.count(id) == 0) {
+            return false;
+        }
+        t_id = id;
+        return true;
+    }
+
+    /**
+     * Tries to get the count of an item.
+     * With approximate counts, items outside the best sellers get their sketch estimate.
+     *
+     * @param t_item the item to get the count of
+     * @param t_count the count of the item
+     * @return true if the count was found, false otherwise
+     */
+    bool tryGetItemCount(const std::string& t_item, int& t_count) {
+        ItemTable::ItemId id;
+        if (!tryFindItem(t_item, id)) {
+            // Items outside the best sellers are estimated from the sketch when counting approximately
+            std::string item = Utils::trim(t_item);
+            long long estimate = m_approximate && !item.empty() ? m_approximateCounts.estimate(item) : 0;
+            if (estimate == 0) {
+                return false;
+            }
+            t_count = static_cast<int>(std::min<long long>(estimate, INT_MAX));
+            return true;
+        }
+        t_count = m_itemCounts.count(id);
+        return true;
+    }
+
+    /**
+     * Gets the ids of all items ordered by name.
+     * The view is cached and rebuilt only after the database changes.
+     *
+     * @return the item ids sorted by name, valid until the database changes
+     */
+    const std::vector<ItemTable::ItemId>& getItemsByName() const {
+        if (m_itemsByNameVersion != m_version) {
+            // An item whose only sighting was rescanned as part of a longer item has a count of 0
+            m_itemsByName = m_itemCounts.sortedByName();
+            m_itemsByName.erase(std::remove_if(m_itemsByName.begin(), m_itemsByName.end(), [this](ItemTable::ItemId t_id) {
+                return m_itemCounts.count(t_id) == 0;
+            }), m_itemsByName.end());
+            m_itemsByNameVersion = m_version;
+        }
+        return m_itemsByName;
+    }
+
+    /**
+     * Gets the ids of all items ordered by count, highest first, with ties ordered by name.
+     * The view is cached and rebuilt only after the database changes.
+     *
+     * @return the item ids sorted by count, valid until the database changes
+     */
+    const std::vector<ItemTable::ItemId>& getItemsByCount() const {
+        if (m_itemsByCountVersion != m_version) {
+            m_itemsByCount = getItemsByName();
+            std::stable_sort(m_itemsByCount.begin(), m_itemsByCount.end(), [this](ItemTable::ItemId t_left, ItemTable::ItemId t_right) {
+                return m_itemCounts.count(t_left) > m_itemCounts.count(t_right);
+            });
+            m_itemsByCountVersion = m_version;
+        }
+        return m_itemsByCount;
+    }
+
+    /**
+     * Gets the best selling items.
+     *
+     * @param t_limit the most items to return
+     * @return the item ids, highest count first, ties ordered by name
+     */
+    std::vector<ItemTable::ItemId> getTopItems(size_t t_limit) const {
+        ScopedTimer timer("rank query");
+        return m_countIndex.top(t_limit, m_itemCounts);
+    }
+
+    /**
+     * Gets the slowest selling items.
+     *
+     * @param t_limit the most items to return
+     * @return the item ids, lowest count first, ties ordered by name
+     */
+    std::vector<ItemTable::ItemId> getBottomItems(size_t t_limit) const {
+        ScopedTimer timer("rank query");
+        return m_countIndex.bottom(t_limit, m_itemCounts);
+    }
+
+    /**
+     * Gets the items whose count is within a range.
+     *
+     * @param t_min the lowest count to include
+     * @param t_max the highest count to include
+     * @param t_limit the most items to return
+     * @return the item ids, highest count first, ties ordered by name
+     */
+    std::vector<ItemTable::ItemId> getItemsInCountRange(int t_min, int t_max, size_t t_limit) const {
+        ScopedTimer timer("range query");
+        return m_countIndex.inRange(t_min, t_max, t_limit, m_itemCounts);
+    }
+
+    /**
+     * Gets the best selling items over the latest hours or days with sales.
+     *
+     * @param t_length the number of hours or days
+     * @param t_days true to count days, false to count hours
+     * @param t_limit the most items to return
+     * @return the item ids, highest count in the window first, ties ordered by name
+     */
+    std::vector<ItemTable::ItemId> getRecentTopItems(long long t_length, bool t_days, size_t t_limit) const {
+        return getRecentWindow(t_length, t_days).top(t_limit, m_itemCounts);
+    }
+
+    /**
+     * Gets the count of an item over the latest hours or days with sales.
+     *
+     * @param t_id the id of the item
+     * @param t_length the number of hours or days
+     * @param t_days true to count days, false to count hours
+     * @return the count in the window
+     */
+    long long getRecentItemCount(ItemTable::ItemId t_id, long long t_length, bool t_days) const {
+        return getRecentWindow(t_length, t_days).total(t_id);
+    }
+
+    /**
+     * Gets the totals over the latest periods with sales, moving the cached window forward
+     * when new periods were added. Only a different length or unit recomputes it.
+     *
+     * @param t_length the number of hours or days covered
+     * @param t_days true to count days, false to count hours
+     * @return the window, ending with the latest period that has sales
+     */
+    const TimeWindow& getRecentWindow(long long t_length, bool t_days) const {
+        ScopedTimer timer("window query");
+        const TimeBuckets& buckets = t_days ? m_dayBuckets : m_hourBuckets;
+        if (m_recentWindow.getLength() != t_length || m_recentWindowInDays != t_days) {
+            m_recentWindow.reset(t_length);
+            m_recentWindowInDays = t_days;
+        }
+        m_recentWindow.advanceTo(buckets.latestPeriod() + 1, buckets);
+        return m_recentWindow;
+    }
+
+    /**
+     * Gets the number of stores with their own counts.
+     *
+     * @return the number of input files kept apart, 0 without a per store breakdown
+     */
+    size_t getStoreCount() const {
+        return m_storeCounts.size();
+    }
+
+    /**
+     * Gets the name of a store.
+     *
+     * @param t_store the index of the store, less than getStoreCount()
+     * @return the name of the input file the store was read from
+     */
+    const std::string& getStoreName(size_t t_store) const {
+        return m_storeNames[t_store];
+    }
+
+    /**
+     * Gets the count of an item in one store.
+     *
+     * @param t_store the index of the store, less than getStoreCount()
+     * @param t_id the id of the item in the totals
+     * @return the count in that store, 0 if the store never sold it
+     */
+    int getStoreItemCount(size_t t_store, ItemTable::ItemId t_id) const {
+        const ItemTable& storeCounts = m_storeCounts[t_store];
+        ItemTable::ItemId storeId = storeCounts.find(m_itemCounts.name(t_id));
+        return storeId == ItemTable::NOT_FOUND ? 0 : storeCounts.count(storeId);
+    }
+
+    /**
+     * Gets the time just after the latest sale.
+     *
+     * @return the end of the latest hour with sales in seconds since 1970-01-01T00:00, -1 if none
+     */
+    long long getLatestTime() const {
+        return m_hourBuckets.latestPeriod() < 0 ? -1 : (m_hourBuckets.latestPeriod() + 1) * 3600;
+    }
+
+    /**
+     * Finds the best selling items whose names start with a prefix, ignoring case.
+     * The search index is built on first use and rebuilt only after the database changes.
+     *
+     * @param t_prefix the prefix
+     * @param t_limit the most results to return
+     * @return the matching item ids, highest count first
+     */
+    std::vector<ItemTable::ItemId> findItemsByPrefix(const std::string& t_prefix, size_t t_limit) const {
+        ScopedTimer timer("prefix search");
+        return getSearchIndex().completePrefix(t_prefix, m_itemCounts, t_limit);
+    }
+
+    /**
+     * Finds the items whose names are closest to a possibly misspelled name.
+     *
+     * @param t_name the name to search for
+     * @param t_limit the most results to return
+     * @return the matching item ids, closest first
+     */
+    std::vector<ItemTable::ItemId> findSimilarItems(const std::string& t_name, size_t t_limit) const {
+        ScopedTimer timer("fuzzy search");
+        return getSearchIndex().findSimilar(t_name, m_itemCounts, t_limit);
+    }
+
+    /**
+     * Gets the search index, rebuilding it if the database changed.
+     *
+     * @return the search index over the current items
+     */
+    const SearchIndex& getSearchIndex() const {
+        if (m_searchIndexVersion != m_version) {
+            m_searchIndex.build(m_itemCounts, getItemsByName());
+            m_searchIndexVersion = m_version;
+        }
+        return m_searchIndex;
+    }
+
+    /**
+     * Sets how item counts are classified into heat map buckets.
+     *
+     * @param t_scale the scale the buckets are spread over
+     * @param t_bucketCount the number of buckets, one per heat map color
+     */
+    void setHeatScale(HeatMap::Scale t_scale, size_t t_bucketCount) {
+        m_heatMap.configure(t_scale, t_bucketCount);
+        m_heatMapVersion = m_version + 1;
+        getHeatMap();
+    }
+
+    /**
+     * Gets the heat map buckets of the items.
+     * After an append only the items it changed are classified again, unless the thresholds
+     * moved; the items are ranked by count only for the quantile scale.
+     *
+     * @return the heat map, valid until the database changes
+     */
+    const HeatMap& getHeatMap() const {
+        bool allChanged = m_heatMapVersion != m_version;
+        if (allChanged || !m_heatMapChangedIds.empty()) {
+            if (m_heatMap.getScale() == HeatMap::QUANTILE) {
+                m_heatMap.updateQuantiles(m_itemCounts, getItemsByCount());
+            } else if (allChanged) {
+                m_heatMap.updateScaled(m_itemCounts, m_maxItemCount);
+            } else {
+                m_heatMap.updateScaled(m_itemCounts, m_maxItemCount, m_heatMapChangedIds);
+            }
+            m_heatMapChangedIds.clear();
+            m_heatMapVersion = m_version;
+        }
+        return m_heatMap;
+    }
+
+    /**
+     * Calls a function for every item in name order without copying the database.
+     *
+     * @param t_visitor called with the name and count of each item
+     */
+    template <typename Visitor>
+    void forEachItem(Visitor t_visitor) const {
+        for (ItemTable::ItemId id : getItemsByName()) {
+            t_visitor(m_itemCounts.name(id), m_itemCounts.count(id));
+        }
+    }
+
+    /**
+     * Gets the name of an item.
+     *
+     * @param t_id the id of the item
+     * @return view of the item name, valid for the lifetime of the database
+     */
+    StringView getItemName(ItemTable::ItemId t_id) const {
+        return m_itemCounts.name(t_id);
+    }
+
+    /**
+     * Gets the count of an item.
+     *
+     * @param t_id the id of the item
+     * @return the count of the item
+     */
+    int getItemCount(ItemTable::ItemId t_id) const {
+        return m_itemCounts.count(t_id);
+    }
+
+    /**
+     * Gets the number of distinct items.
+     *
+     * @return the number of items
+     */
+    size_t getItemTotal() const {
+        return getItemsByName().size();
+    }
+
+    /**
+     * Gets the database version, which changes whenever the counts change.
+     *
+     * @return the database version
+     */
+    size_t getVersion() const {
+        return m_version;
+    }
+
+    /**
+     * Gets the max item count.
+     *
+     * @return the max item count
+     */
+    int getMaxItemCount() const {
+        return m_maxItemCount;
+    }
+};
+
+/**
+ * Renders the full item reports, one row per item in name order followed by the color key,
+ * into a single preallocated buffer. Frames are cached per report type and reused until the
+ * database version or the width changes, so showing a report again costs one write.
+ * Histogram bars are scaled so the best seller fills the right half of the width.
+ */
+class ReportRenderer {
+public:
+    enum View {
+        NUMERICAL,
+        HISTOGRAM,
+        VIEW_COUNT
+    };
+
+private:
+    struct ColorChange {
+        size_t offset;
+        ConsoleColor color;
+    };
+
+    struct Frame {
+        bool valid = false;
+        size_t version = 0;
+        int width = 0;
+        std::string text;
+        // Windows sets colors on the console handle, so they are kept beside the text
+        std::vector<ColorChange> colorChanges;
+        ConsoleColor color = COLOR_COUNT;
+    };
+
+    Frame m_frames[VIEW_COUNT];
+
+    /**
+     * Switches the color of the text appended next, doing nothing if it is already set.
+     *
+     * @param t_frame the frame being rendered
+     * @param t_color the color to set
+     */
+    static void setColor(Frame& t_frame, ConsoleColor t_color) {
+        if (t_color == t_frame.color) {
+            return;
+        }
+        t_frame.color = t_color;
+    #ifdef _WIN32
+        t_frame.colorChanges.push_back(ColorChange{t_frame.text.size(), t_color});
+    #else
+        t_frame.text += Utils::getConsoleColorCode(t_color);
+    #endif
+    }
+
+    /**
+     * Gets the number of visible characters in UTF-8 text.
+     *
+     * @param t_str the text to measure
+     * @return the number of visible characters
+     */
+    static size_t displayLength(StringView t_str) {
+        size_t length = 0;
+        for (size_t i = 0; i < t_str.size(); i++) {
+            if ((t_str.data()[i] & 0xC0) != 0x80) {
+                length++;
+            }
+        }
+        return length;
+    }
+
+public:
+    static const char* const BLOCK;
+    static const size_t BLOCK_BYTES = 3;
+    static const int MAX_BAR_LENGTH = 512;
+
+    /**
+     * Gets the length of a histogram bar. Counts that fit are drawn one block per sale,
+     * otherwise the bars are scaled to the room, keeping at least one block for any sale.
+     *
+     * @param t_count the count of the item
+     * @param t_maxCount the largest count of any item
+     * @param t_room the most blocks a bar may have
+     * @return the number of blocks to draw
+     */
+    static size_t barLength(int t_count, int t_maxCount, size_t t_room) {
+        if (t_count <= 0 || t_room == 0) {
+            return 0;
+        }
+        if (static_cast<size_t>(t_maxCount) <= t_room) {
+            return static_cast<size_t>(t_count);
+        }
+        size_t length = static_cast<size_t>(static_cast<unsigned long long>(t_count) * t_room / static_cast<unsigned long long>(t_maxCount));
+        return std::max<size_t>(length, 1);
+    }
+
+    /**
+     * Gets the room for histogram bars, the right half of the width after the separator.
+     *
+     * @param t_width the width of a row
+     * @return the most blocks a bar may have
+     */
+    static size_t barRoom(int t_width) {
+        return t_width / 2 > 2 ? static_cast<size_t>(t_width / 2 - 2) : 0;
+    }
+
+    /**
+     * Gets the note that follows the color key when histogram bars are scaled.
+     *
+     * @param t_view the report the key belongs to
+     * @param t_maxCount the largest count of any item
+     * @param t_width the width of a row
+     * @return the note, empty if every block is one sale
+     */
+    static std::string getScaleNote(View t_view, int t_maxCount, int t_width) {
+        size_t room = barRoom(t_width);
+        if (t_view != HISTOGRAM || room == 0 || static_cast<size_t>(t_maxCount) <= room) {
+            return "";
+        }
+        return std::string(" - each ") + BLOCK + " is about " + std::to_string((t_maxCount + room - 1) / room) + " sales";
+    }
+
+    /**
+     * Appends one report row, the name right aligned to the center and the value after it.
+     *
+     * @param t_text the text to append to
+     * @param t_view the report the row belongs to
+     * @param t_name the name of the item
+     * @param t_count the count of the item
+     * @param t_maxCount the largest count of any item, used to scale the bar
+     * @param t_width the width of the row
+     */
+    static void appendRow(std::string& t_text, View t_view, StringView t_name, int t_count, int t_maxCount, int t_width) {
+        size_t centerPoint = static_cast<size_t>(t_width / 2);
+        size_t nameLength = displayLength(t_name);
+        if (nameLength < centerPoint) {
+            t_text.append(centerPoint - nameLength, ' ');
+        }
+        t_text.append(t_name.data(), t_name.size());
+        t_text += ' ';
+        if (t_view == HISTOGRAM) {
+            // Bars are cut from one long run of blocks instead of being built block by block
+            static const std::string bar = Utils::repeatString(BLOCK, MAX_BAR_LENGTH);
+            size_t blocks = std::min<size_t>(barLength(t_count, t_maxCount, barRoom(t_width)), MAX_BAR_LENGTH);
+            t_text.append(bar, 0, blocks * BLOCK_BYTES);
+        } else {
+            char digits[16];
+            int length = std::snprintf(digits, sizeof(digits), "%d", t_count);
+            t_text.append(digits, static_cast<size_t>(length));
+        }
+    }
+
+    /**
+     * Gets a report frame, rendering it only if the database or the width changed since
+     * it was last rendered.
+     *
+     * @param t_database the database to render
+     * @param t_view the report to render
+     * @param t_width the width of a row in columns
+     * @param t_heatMapColors the colors of the heat map buckets, lowest first
+     * @param t_uiColor the color of the color key
+     * @return the frame, valid until the next call for the same view
+     */
+    const Frame& getFrame(const Database& t_database, View t_view, int t_width, const std::vector<ConsoleColor>& t_heatMapColors,
+                          ConsoleColor t_uiColor) {
+        Frame& frame = m_frames[t_view];
+        if (frame.valid && frame.version == t_database.getVersion() && frame.width == t_width) {
+            return frame;
+        }
+        frame.valid = false;
+        frame.text.clear();
+        frame.colorChanges.clear();
+        frame.color = COLOR_COUNT;
+
+        int maxCount = t_database.getMaxItemCount();
+        size_t room = barRoom(t_width);
+
+        // Reserve for the longest possible rows so the buffer never grows while rendering
+        size_t rowBytes = static_cast<size_t>(t_width / 2) + 2 + (t_view == HISTOGRAM ? room * BLOCK_BYTES : 12) + 8;
+        frame.text.reserve(t_database.getItemTotal() * rowBytes + 256);
+        const HeatMap& heatMap = t_database.getHeatMap();
+        for (ItemTable::ItemId id : t_database.getItemsByName()) {
+            setColor(frame, t_heatMapColors[heatMap.bucket(id)]);
+            appendRow(frame.text, t_view, t_database.getItemName(id), t_database.getItemCount(id), maxCount, t_width);
+            frame.text += '\n';
+        }
+
+        // Color key
+        setColor(frame, t_uiColor);
+        frame.text += "\nColor Key: 1 ";
+        for (ConsoleColor color : t_heatMapColors) {
+            setColor(frame, color);
+            frame.text += BLOCK;
+        }
+        setColor(frame, t_uiColor);
+        frame.text += ' ';
+        frame.text += std::to_string(maxCount);
+        frame.text += getScaleNote(t_view, maxCount, t_width);
+        frame.text += '\n';
+
+        frame.version = t_database.getVersion();
+        frame.width = t_width;
+        frame.valid = true;
+        return frame;
+    }
+
+    /**
+     * Writes a frame to standard output in one go.
+     *
+     * @param t_frame the frame to write
+     */
+    static void draw(const Frame& t_frame) {
+        BufferedWriter output(stdout);
+    #ifdef _WIN32
+        size_t start = 0;
+        for (const ColorChange& change : t_frame.colorChanges) {
+            output.write(StringView(t_frame.text.data() + start, change.offset - start));
+            output.setColor(change.color);
+            start = change.offset;
+        }
+        output.write(StringView(t_frame.text.data() + start, t_frame.text.size() - start));
+    #else
+        output.write(t_frame.text);
+    #endif
+        output.flush();
+    }
+};
+
+const char* const ReportRenderer::BLOCK = "█";
+
+/**
+ * Interactive viewer for the full item reports that only formats and draws the rows on screen,
+ * so a redraw costs the same for twenty items as for a million. Rows scroll with the arrow and
+ * page keys, a letter jumps to the next item starting with it, and Tab changes the order.
+ */
+class ItemViewer {
+public:
+    enum Order {
+        BY_NAME,
+        BY_COUNT_DESCENDING,
+        BY_COUNT_ASCENDING,
+        ORDER_COUNT
+    };
+
+private:
+    // Screen lines that are not item rows: the title, two blank lines, the color key and the key help
+    static const int CHROME_LINES = 5;
+
+    const Database& m_database;
+    ReportRenderer::View m_view;
+    Order m_order = BY_NAME;
+    size_t m_top = 0;
+
+    /**
+     * Gets the item shown at a position in the current order.
+     *
+     * @param t_position the position, from 0 to the number of items
+     * @return the id of the item
+     */
+    ItemTable::ItemId itemAt(size_t t_position) const {
+        if (m_order == BY_NAME) {
+            return m_database.getItemsByName()[t_position];
+        }
+        const std::vector<ItemTable::ItemId>& byCount = m_database.getItemsByCount();
+        return m_order == BY_COUNT_DESCENDING ? byCount[t_position] : byCount[byCount.size() - 1 - t_position];
+    }
+
+    /**
+     * Moves the first visible row to the next item whose name starts with a character,
+     * ignoring case and wrapping around at the end.
+     *
+     * @param t_char the character to look for
+     */
+    void jumpTo(int t_char) {
+        size_t itemTotal = m_database.getItemTotal();
+        int wanted = std::tolower(t_char);
+        for (size_t step = 1; step <= itemTotal; step++) {
+            size_t position = (m_top + step) % itemTotal;
+            StringView name = m_database.getItemName(itemAt(position));
+            if (name.size() > 0 && std::tolower(static_cast<unsigned char>(name.data()[0])) == wanted) {
+                m_top = position;
+                return;
+            }
+        }
+    }
+
+    /**
+     * Draws the visible rows and the lines around them over the whole screen.
+     *
+     * @param t_rows the number of terminal rows
+     * @param t_width the width of a row
+     * @param t_heatMapColors the colors of the heat map buckets, lowest first
+     * @param t_uiColor the color of everything but the rows
+     */
+    void draw(int t_rows, int t_width, const std::vector<ConsoleColor>& t_heatMapColors, ConsoleColor t_uiColor) const {
+        ScopedTimer timer("render page");
+        static const char* const orderNames[ORDER_COUNT] = {"name", "count, highest first", "count, lowest first"};
+        size_t itemTotal = m_database.getItemTotal();
+        size_t visibleRows = static_cast<size_t>(std::max(t_rows - CHROME_LINES, 1));
+        size_t shownRows = std::min(visibleRows, itemTotal - m_top);
+        int maxCount = m_database.getMaxItemCount();
+        const HeatMap& heatMap = m_database.getHeatMap();
+        BufferedWriter output(stdout);
+        std::string line;
+        int screenLine = 1;
+        auto startLine = [&]() {
+            output.write("\033[");
+            output.writeNumber(screenLine++);
+            output.write(";1H\033[K");
+        };
+
+        // Title
+        startLine();
+        output.setColor(t_uiColor);
+        line = "Items by " + std::string(orderNames[m_order]) + " - " + std::to_string(itemTotal == 0 ? 0 : m_top + 1) + " to " +
+               std::to_string(m_top + shownRows) + " of " + std::to_string(itemTotal);
+        output.write(line);
+        startLine();
+
+        // Only the visible rows are formatted
+        for (size_t i = 0; i < visibleRows; i++) {
+            startLine();
+            if (i < shownRows) {
+                ItemTable::ItemId id = itemAt(m_top + i);
+                int count = m_database.getItemCount(id);
+                line.clear();
+                ReportRenderer::appendRow(line, m_view, m_database.getItemName(id), count, maxCount, t_width);
+                output.setColor(t_heatMapColors[heatMap.bucket(id)]);
+                output.write(line);
+            }
+        }
+
+        // Color key and the keys the viewer understands
+        startLine();
+        startLine();
+        output.setColor(t_uiColor);
+        output.write("Color Key: 1 ");
+        for (ConsoleColor color : t_heatMapColors) {
+            output.setColor(color);
+            output.write(ReportRenderer::BLOCK);
+        }
+        output.setColor(t_uiColor);
+        output.write(' ');
+        output.writeNumber(maxCount);
+        output.write(ReportRenderer::getScaleNote(m_view, maxCount, t_width));
+        startLine();
+        output.write("Up/Down, PgUp/PgDn, Home/End scroll - a letter jumps to it - Tab sorts - Enter or Esc returns");
+        output.flush();
+    }
+
+public:
+    /**
+     * Creates a viewer starting at the first item in name order.
+     *
+     * @param t_database the database to show, which must outlive the viewer
+     * @param t_view the report to show
+     */
+    ItemViewer(const Database& t_database, ReportRenderer::View t_view) : m_database(t_database), m_view(t_view) {}
+
+    /**
+     * Checks if a list of items needs the viewer to fit on the screen.
+     *
+     * @param t_itemTotal the number of items
+     * @param t_rows the number of terminal rows
+     * @return true if the items and the color key do not fit, false otherwise
+     */
+    static bool isNeeded(size_t t_itemTotal, int t_rows) {
+        return t_itemTotal + CHROME_LINES > static_cast<size_t>(std::max(t_rows, 0));
+    }
+
+    /**
+     * Shows the report on the alternate screen until Enter, Escape or Ctrl+C is pressed.
+     *
+     * @param t_keyboard the keyboard to read keys from, switched to single keys
+     * @param t_displayWidth the widest a row may be
+     * @param t_heatMapColors the colors of the heat map buckets, lowest first
+     * @param t_uiColor the color of everything but the rows
+     */
+    void run(Keyboard& t_keyboard, int t_displayWidth, const std::vector<ConsoleColor>& t_heatMapColors, ConsoleColor t_uiColor) {
+        // Switch to the alternate screen, hide the cursor and stop long names from wrapping
+        Utils::enableEscapeSequences();
+        std::cout << "\033[?1049h\033[?25l\033[?7l" << std::flush;
+        while (true) {
+            // The terminal size is read before every redraw so resizing just works
+            int rows;
+            int columns;
+            Utils::getTerminalSize(rows, columns);
+            size_t itemTotal = m_database.getItemTotal();
+            size_t page = static_cast<size_t>(std::max(rows - CHROME_LINES, 1));
+            size_t lastTop = itemTotal > page ? itemTotal - page : 0;
+            m_top = std::min(m_top, lastTop);
+            draw(rows, std::min(t_displayWidth, columns), t_heatMapColors, t_uiColor);
+
+            int key = t_keyboard.read();
+            if (key < 0 || key == Keyboard::KEY_ENTER || key == Keyboard::KEY_ESCAPE || key == Keyboard::KEY_INTERRUPT) {
+                break;
+            }
+            switch (key) {
+                case Keyboard::KEY_UP: m_top = m_top > 0 ? m_top - 1 : 0; break;
+                case Keyboard::KEY_DOWN: m_top = std::min(m_top + 1, lastTop); break;
+                case Keyboard::KEY_PAGE_UP: m_top = m_top > page ? m_top - page : 0; break;
+                case Keyboard::KEY_PAGE_DOWN: case ' ': m_top = std::min(m_top + page, lastTop); break;
+                case Keyboard::KEY_HOME: m_top = 0; break;
+                case Keyboard::KEY_END: m_top = lastTop; break;
+                case Keyboard::KEY_TAB:
+                    m_order = static_cast<Order>((m_order + 1) % ORDER_COUNT);
+                    m_top = 0;
+                    break;
+                default:
+                    if (key < 0x80 && std::isalnum(key)) {
+                        jumpTo(key);
+                    }
+                    break;
+            }
+        }
+        std::cout << "\033[?7h\033[?25h\033[?1049l" << std::flush;
+    }
+};
+
+/**
+ * Answers lookups from other processes over a Unix domain socket, so the database is built
+ * once instead of by every query. One thread serves every client from a poll() loop with
+ * non-blocking sockets and per client buffers.
+ *
+ * The protocol is line based. Each request is one line, a command and its arguments:
+ * PING, COUNT ITEM, TOP [K], BOTTOM [K], PREFIX TEXT [K], DUMP or QUIT. Each reply starts
+ * with a status line, "OK N" followed by N lines of "ITEM COUNT", "NOTFOUND" or "ERR MESSAGE".
+ * QUIT is answered with "OK 0" before the connection is closed.
+ */
+class QueryServer {
+public:
+    class ServerError : public std::runtime_error {
+    public:
+        explicit ServerError(const std::string& message) : std::runtime_error(message) {}
+    };
+
+private:
+    struct Client {
+        int fd;
+        std::string input;
+        std::string output;
+        size_t outputSent = 0;
+        bool hungUp = false;
+        bool closing = false;
+
+        /**
+         * Gets the number of reply bytes not yet sent.
+         */
+        size_t queuedOutput() const {
+            return output.length() - outputSent;
+        }
+    };
+
+    static const size_t MAX_REQUEST_LENGTH = 4096;
+    // A client that does not read its replies, or sends faster than it is answered, is not
+    // read from until it catches up; each wakeup reads a bounded amount so others get a turn
+    static const size_t MAX_QUEUED_OUTPUT = 1 << 20;
+    static const size_t MAX_QUEUED_INPUT = 1 << 20;
+    static const size_t MAX_READ_PER_WAKEUP = 64 * 1024;
+    static const size_t DEFAULT_LIMIT = 10;
+
+    Database& m_database;
+    std::string m_socketPath;
+    int m_listenFd = -1;
+    std::vector<Client> m_clients;
+
+    /**
+     * Appends the reply to a request to a client's output.
+     *
+     * @param t_request the request line without its line break
+     * @param t_client the client that sent it
+     */
+    void answer(const std::string& t_request, Client& t_client) {
+        ScopedTimer timer("serve request");
+        std::string request = Utils::trim(t_request);
+        size_t space = request.find(' ');
+        std::string command = request.substr(0, space);
+        std::string argument = space == std::string::npos ? "" : Utils::trim(request.substr(space + 1));
+        std::transform(command.begin(), command.end(), command.begin(), [](char c) {
+            return static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+        });
+
+        std::string& reply = t_client.output;
+        if (command == "PING") {
+            reply += "OK 0\n";
+        } else if (command == "QUIT") {
+            reply += "OK 0\n";
+            t_client.closing = true;
+        } else if (command == "COUNT") {
+            ItemTable::ItemId id;
+            int count;
+            if (m_database.tryFindItem(argument, id)) {
+                reply += "OK 1\n";
+                appendItem(reply, m_database.getItemName(id), m_database.getItemCount(id));
+            } else if (m_database.tryGetItemCount(argument, count)) {
+                reply += "OK 1\n";
+                appendItem(reply, argument, count);
+            } else {
+                reply += "NOTFOUND\n";
+            }
+        } else if (command == "TOP" || command == "BOTTOM") {
+            size_t limit;
+            if (!tryParseLimit(argument, limit)) {
+                reply += "ERR invalid count: " + argument + "\n";
+                return;
+            }
+            appendItems(reply, command == "TOP" ? m_database.getTopItems(limit) : m_database.getBottomItems(limit));
+        } else if (command == "PREFIX") {
+            size_t split = argument.find(' ');
+            size_t limit;
+            if (argument.empty() || !tryParseLimit(split == std::string::npos ? "" : Utils::trim(argument.substr(split + 1)), limit)) {
+                reply += "ERR usage: PREFIX TEXT [K]\n";
+                return;
+            }
+            appendItems(reply, m_database.findItemsByPrefix(argument.substr(0, split), limit));
+        } else if (command == "DUMP") {
+            appendItems(reply, m_database.getItemsByName());
+        } else {
+            reply += "ERR unknown command: " + command + "\n";
+        }
+    }
+
+    /**
+     * Parses the optional result limit of a request.
+     *
+     * @param t_value the limit, empty for the default
+     * @param t_limit set to the limit if it is valid
+     * @return true if the limit is valid, false otherwise
+     */
+    static bool tryParseLimit(const std::string& t_value, size_t& t_limit) {
+        unsigned long long number = DEFAULT_LIMIT;
+        if (!t_value.empty() && (!Utils::tryParseUnsigned(t_value, 1000000000ULL, number) || number == 0)) {
+            return false;
+        }
+        t_limit = static_cast<size_t>(number);
+        return true;
+    }
+
+    /**
+     * Appends a list of items to a reply, status line first.
+     *
+     * @param t_reply the reply to append to
+     * @param t_ids the items, in order
+     */
+    void appendItems(std::string& t_reply, const std::vector<ItemTable::ItemId>& t_ids) const {
+        t_reply += "OK " + std::to_string(t_ids.size()) + "\n";
+        for (ItemTable::ItemId id : t_ids) {
+            appendItem(t_reply, m_database.getItemName(id), m_database.getItemCount(id));
+        }
+    }
+
+    /**
+     * Appends one "ITEM COUNT" line to a reply.
+     *
+     * @param t_reply the reply to append to
+     * @param t_name the name of the item
+     * @param t_count the count of the item
+     */
+    static void appendItem(std::string& t_reply, StringView t_name, int t_count) {
+        t_reply.append(t_name.data(), t_name.size());
+        t_reply += ' ';
+        t_reply += std::to_string(t_count);
+        t_reply += '\n';
+    }
+
+#ifndef _WIN32
+    /**
+     * Fills in the address of a socket file.
+     *
+     * @param t_path the path of the socket file
+     * @param t_address the address to fill in
+     * @throws ServerError if the path is too long for a socket address
+     */
+    static void makeAddress(const std::string& t_path, struct sockaddr_un& t_address) {
+        std::memset(&t_address, 0, sizeof(t_address));
+        t_address.sun_family = AF_UNIX;
+        if (t_path.empty() || t_path.length() >= sizeof(t_address.sun_path)) {
+            throw ServerError("Invalid socket path: " + t_path);
+        }
+        std::memcpy(t_address.sun_path, t_path.c_str(), t_path.length() + 1);
+    }
+
+    /**
+     * Accepts every pending connection.
+     */
+    void acceptClients() {
+        while (true) {
+            int fd = accept(m_listenFd, nullptr, nullptr);
+            if (fd < 0) {
+                return;
+            }
+            fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+            Client client;
+            client.fd = fd;
+            m_clients.push_back(std::move(client));
+        }
+    }
+
+    /**
+     * Reads up to MAX_READ_PER_WAKEUP bytes of what a client sent and answers the complete
+     * request lines. The rest is read on later wakeups.
+     *
+     * @param t_client the client to read from
+     */
+    void readRequests(Client& t_client) {
+        char buffer[4096];
+        ssize_t length = 1;
+        size_t received = 0;
+        while (received < MAX_READ_PER_WAKEUP && t_client.input.length() < MAX_QUEUED_INPUT &&
+               (length = read(t_client.fd, buffer, sizeof(buffer))) > 0) {
+            t_client.input.append(buffer, static_cast<size_t>(length));
+            received += static_cast<size_t>(length);
+        }
+        // A client that stopped sending still gets the replies to what it sent
+        t_client.hungUp = length == 0 || (length < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR);
+        answerRequests(t_client);
+    }
+
+    /**
+     * Answers the complete request lines a client sent, stopping while too many reply bytes
+     * are queued for it; the rest are answered once it has read enough.
+     *
+     * @param t_client the client to answer
+     */
+    void answerRequests(Client& t_client) {
+        size_t start = 0;
+        size_t lineEnd;
+        while (!t_client.closing && t_client.queuedOutput() <= MAX_QUEUED_OUTPUT &&
+               (lineEnd = t_client.input.find('\n', start)) != std::string::npos) {
+            answer(t_client.input.substr(start, lineEnd - start), t_client);
+            start = lineEnd + 1;
+        }
+        t_client.input.erase(0, start);
+        bool hasCompleteRequest = t_client.input.find('\n') != std::string::npos;
+        if (!hasCompleteRequest && t_client.input.length() > MAX_REQUEST_LENGTH) {
+            t_client.output += "ERR request too long\n";
+            t_client.closing = true;
+        }
+        t_client.closing = t_client.closing || (t_client.hungUp && !hasCompleteRequest);
+    }
+
+    /**
+     * Sends as much of a client's queued replies as the socket takes.
+     *
+     * @param t_client the client to write to
+     */
+    static void writeReplies(Client& t_client) {
+        while (t_client.outputSent < t_client.output.length()) {
+            ssize_t length = write(t_client.fd, t_client.output.data() + t_client.outputSent, t_client.output.length() - t_client.outputSent);
+            if (length < 0) {
+                if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                    t_client.output.clear();
+                    t_client.outputSent = 0;
+                    t_client.closing = true;
+                }
+                return;
+            }
+            t_client.outputSent += static_cast<size_t>(length);
+        }
+        t_client.output.clear();
+        t_client.outputSent = 0;
+    }
+#endif
+
+public:
+    /**
+     * Creates a server for a database.
+     *
+     * @param t_database the database to answer from, which must outlive the server
+     */
+    explicit QueryServer(Database& t_database) : m_database(t_database) {}
+
+    QueryServer(const QueryServer&) = delete;
+    QueryServer& operator=(const QueryServer&) = delete;
+
+    ~QueryServer() {
+    #ifndef _WIN32
+        for (Client& client : m_clients) {
+            close(client.fd);
+        }
+        if (m_listenFd >= 0) {
+            close(m_listenFd);
+            unlink(m_socketPath.c_str());
+        }
+    #endif
+    }
+
+    /**
+     * Starts listening on a socket file. A socket file left behind by a server that is no
+     * longer running is replaced; one that still answers is left alone.
+     *
+     * @param t_path the path of the socket file
+     * @throws ServerError if the socket cannot be created
+     */
+    void listen(const std::string& t_path) {
+    #ifdef _WIN32
+        throw ServerError("The query server needs Unix domain sockets, which this build does not support: " + t_path);
+    #else
+        struct sockaddr_un address;
+        makeAddress(t_path, address);
+
+        // Only a socket nobody answers on is removed; any other file at the path is left alone
+        struct stat existing;
+        if (lstat(t_path.c_str(), &existing) == 0) {
+            if (!S_ISSOCK(existing.st_mode)) {
+                throw ServerError(t_path + " exists and is not a socket");
+            }
+            int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+            if (probe < 0) {
+                throw ServerError("Could not create a socket: " + std::string(std::strerror(errno)));
+            }
+            bool answered = connect(probe, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) == 0;
+            int probeError = errno;
+            close(probe);
+            if (answered) {
+                throw ServerError("Another server is already listening on " + t_path);
+            }
+            if (probeError != ECONNREFUSED) {
+                throw ServerError("Could not check the socket " + t_path + ": " + std::strerror(probeError));
+            }
+            unlink(t_path.c_str());
+        }
+
+        m_listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (m_listenFd < 0 || bind(m_listenFd, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) != 0 ||
+            ::listen(m_listenFd, SOMAXCONN) != 0) {
+            std::string reason = std::strerror(errno);
+            if (m_listenFd >= 0) {
+                close(m_listenFd);
+                m_listenFd = -1;
+            }
+            throw ServerError("Could not listen on " + t_path + ": " + reason);
+        }
+        fcntl(m_listenFd, F_SETFL, fcntl(m_listenFd, F_GETFL) | O_NONBLOCK);
+        m_socketPath = t_path;
+    #endif
+    }
+
+    /**
+     * Serves clients until the stop flag is set, typically by a signal handler.
+     *
+     * @param t_stopRequested checked at least every quarter of a second
+     */
+    void run(volatile std::sig_atomic_t& t_stopRequested) {
+    #ifdef _WIN32
+        (void)t_stopRequested;
+    #else
+        // A client that hangs up early must not kill the server with SIGPIPE
+        std::signal(SIGPIPE, SIG_IGN);
+        std::vector<struct pollfd> pollFds;
+        while (!t_stopRequested) {
+            pollFds.clear();
+            pollFds.push_back({m_listenFd, POLLIN, 0});
+            for (const Client& client : m_clients) {
+                short events = 0;
+                if (!client.closing && !client.hungUp && client.queuedOutput() <= MAX_QUEUED_OUTPUT &&
+                    client.input.length() < MAX_QUEUED_INPUT) {
+                    events |= POLLIN;
+                }
+                if (client.queuedOutput() > 0) {
+                    events |= POLLOUT;
+                }
+                pollFds.push_back({client.fd, events, 0});
+            }
+            if (poll(pollFds.data(), pollFds.size(), 250) <= 0) {
+                continue;
+            }
+
+            // Clients are only added after the existing ones are served, so indexes match pollFds
+            for (size_t i = 0; i < m_clients.size(); i++) {
+                Client& client = m_clients[i];
+                short events = pollFds[i + 1].revents;
+                if ((pollFds[i + 1].events & POLLIN) && (events & (POLLIN | POLLHUP | POLLERR))) {
+                    readRequests(client);
+                }
+                if (client.queuedOutput() > 0) {
+                    writeReplies(client);
+                    // Requests held back while the client was behind are answered as it catches up
+                    answerRequests(client);
+                }
+            }
+            m_clients.erase(std::remove_if(m_clients.begin(), m_clients.end(), [](const Client& t_client) {
+                if (t_client.closing && t_client.output.empty()) {
+                    close(t_client.fd);
+                    return true;
+                }
+                return false;
+            }), m_clients.end());
+            if (pollFds[0].revents & POLLIN) {
+                acceptClients();
+            }
+        }
+        std::signal(SIGPIPE, SIG_DFL);
+    #endif
+    }
+
+    /**
+     * Sends requests to a running server and collects the replies.
+     *
+     * @param t_path the path of the server's socket file
+     * @param t_requests the request lines, sent in order over one connection
+     * @param t_onReply called with the status line and the item lines of each reply
+     * @throws ServerError if the server cannot be reached or hangs up early
+     */
+    template <typename ReplyCallback>
+    static void sendRequests(const std::string& t_path, const std::vector<std::string>& t_requests, ReplyCallback t_onReply) {
+    #ifdef _WIN32
+        (void)t_requests;
+        (void)t_onReply;
+        throw ServerError("The query server needs Unix domain sockets, which this build does not support: " + t_path);
+    #else
+        struct sockaddr_un address;
+        makeAddress(t_path, address);
+        int fd = -1;
+        auto connectToServer = [&]() {
+            fd = socket(AF_UNIX, SOCK_STREAM, 0);
+            if (fd < 0 || connect(fd, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) != 0) {
+                std::string reason = std::strerror(errno);
+                if (fd >= 0) {
+                    close(fd);
+                }
+                throw ServerError("Could not connect to " + t_path + ": " + reason);
+            }
+        };
+        // A server that went away must surface as an error from write(), not end the process
+        std::signal(SIGPIPE, SIG_IGN);
+        connectToServer();
+
+        // Requests are sent one at a time so each reply can be told apart by its status line
+        std::string received;
+        size_t cursor = 0;
+        auto readLine = [&](std::string& t_line) {
+            size_t lineEnd;
+            while ((lineEnd = received.find('\n', cursor)) == std::string::npos) {
+                char buffer[65536];
+                ssize_t length = read(fd, buffer, sizeof(buffer));
+                if (length <= 0) {
+                    close(fd);
+                    throw ServerError("The server at " + t_path + " closed the connection");
+                }
+                received.append(buffer, static_cast<size_t>(length));
+            }
+            t_line.assign(received, cursor, lineEnd - cursor);
+            cursor = lineEnd + 1;
+        };
+        for (const std::string& request : t_requests) {
+            std::string line = request + "\n";
+            if (write(fd, line.data(), line.length()) != static_cast<ssize_t>(line.length())) {
+                close(fd);
+                throw ServerError("Could not send the request to " + t_path);
+            }
+            std::string status;
+            readLine(status);
+            std::vector<std::string> items;
+            unsigned long long itemCount = 0;
+            if (status.compare(0, 3, "OK ") == 0 && Utils::tryParseUnsigned(status.substr(3), ULLONG_MAX, itemCount)) {
+                items.resize(static_cast<size_t>(itemCount));
+                for (std::string& item : items) {
+                    readLine(item);
+                }
+            }
+            t_onReply(status, items);
+            received.erase(0, cursor);
+            cursor = 0;
+
+            // The server closes the connection after QUIT, so later requests need a new one
+            std::string command = Utils::trim(request);
+            command = command.substr(0, command.find(' '));
+            std::transform(command.begin(), command.end(), command.begin(), [](char c) {
+                return static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+            });
+            if (command == "QUIT" && &request != &t_requests.back()) {
+                close(fd);
+                received.clear();
+                connectToServer();
+            }
+        }
+        close(fd);
+        std::signal(SIGPIPE, SIG_DFL);
+    #endif
+    }
+};
+
+/**
+ * Inventory Analyzer class serves as the program controller.
+ */
+class InventoryAnalyzer {
+private:
+    std::vector<std::string> m_inputFileNames = { "CS210_Project_Three_Input_File.txt" };
+    bool m_hasInputArgument = false;
+    bool m_byStore = false;
+    bool m_printStats = false;
+    std::string m_statsFileName;
+    std::string m_outputFileName = "frequency.dat";
+    unsigned int m_threadCount = 1;
+    bool m_rebuild = false;
+    bool m_batchMode = false;
+    bool m_writeBackup = true;
+    std::vector<std::string> m_queries;
+    std::string m_prefixQuery;
+    std::string m_suggestQuery;
+    size_t m_resultLimit = 10;
+    size_t m_topCount = 0;
+    size_t m_bottomCount = 0;
+    bool m_hasCountRange = false;
+    int m_countRangeMin = 0;
+    int m_countRangeMax = 0;
+    long long m_windowLength = 0;
+    bool m_windowInDays = false;
+    std::string m_reportType = "none";
+    std::string m_outputFormat = "text";
+    bool m_watchMode = false;
+    unsigned int m_frameRate = 4;
+    bool m_serveMode = false;
+    std::string m_socketPath = "inventory.sock";
+    std::vector<std::string> m_clientRequests;
+    bool m_helpRequested = false;
+    static volatile std::sig_atomic_t s_stopRequested;
+    int m_displayWidth = 80;
+    ConsoleColor m_uiColor = COLOR_CYAN;
+    Database m_database;
+    ReportRenderer m_reportRenderer;
+    std::vector<std::string> m_mainMenuOptions = {
+        "Search for Item by Name",
+        "Display Count of All Items (Numerical)",
+        "Display Count of All Items (Histogram)",
+        "Search for Items Starting With",
+        "Display Best Sellers",
+        "Display Slowest Sellers",
+        "Display Items by Count Range",
+        "Exit"
+    };
+    // define histogram colors as heatmap, one per bucket from the lowest counts up
+    std::vector<ConsoleColor> m_heatMapColors = {
+        COLOR_RED,
+        COLOR_YELLOW,
+        COLOR_GREEN,
+        COLOR_BLUE,
+    };
+    HeatMap::Scale m_heatScale = HeatMap::LINEAR;
+
+    /**
+     * Prints ASCII Art Logo Part 1
+     */
+     void printLogoPart1() {
+        std::cout << "    ░░░░░░░░░░░                                                                 " << std::endl;
         std::cout << "   ▒▒▓▓▓▓▓▓▓▓▒░                                                                 " << std::endl;
         std::cout << "  ▒▓▓▓▓▒▒▒▒▒▒▒░  ░▒▓▓▓▓▓▓▓▓░░ ░▒▓▓▒░▒▓▒░▒▓▓▓▒▒▒▓▓▓▓▒░  ░░▒▓▓▓▓▓▓▒░  ░▒▓▓▒▒▓▓▒░  " << std::endl;
         std::cout << "  ▒▓▓▓▒        ░▒▓▓▓▒▒▒▒▒▓▓▓▓░░▒▓▓▓▓▒▒▒░▒▓▓▓▓▓▒▒▒▓▓▓▓░░▒▓▓▓▒▒▒▒▒▓▒░ ░▒▓▓▓▓▒▒░░  " << std::endl;
@@ -645,7 +6481,7 @@ private:
     void printWelcomeMessage() {
         Utils::setConsoleTextColor(m_uiColor);
         printLogoPart1();
-        Utils::setConsoleTextColor("green");
+        Utils::setConsoleTextColor(COLOR_GREEN);
         printLogoPart2();
         Utils::setConsoleTextColor(m_uiColor);
         std::cout << Utils::centerString("", m_displayWidth, "═", "╔", "╗") << std::endl;
@@ -654,6 +6490,21 @@ private:
         std::cout << Utils::centerString("", m_displayWidth, "═", "╚", "╝") << std::endl << std::endl;
     }
 
+    /**
+     * Builds the database from the input files. A single file can resume from the backup;
+     * several files, or a per store breakdown, are counted together by buildDatabaseFromFiles().
+     *
+     * @throws Database::DatabaseError if the database cannot be built
+     */
+    void buildDatabase() {
+        m_database.setHeatScale(m_heatScale, m_heatMapColors.size());
+        if (m_inputFileNames.size() > 1 || m_byStore) {
+            m_database.buildDatabaseFromFiles(m_inputFileNames, m_threadCount);
+        } else {
+            m_database.buildDatabaseFromFile(m_inputFileNames.front(), m_threadCount, m_rebuild ? "" : m_outputFileName);
+        }
+    }
+
     /**
      * Tries to build the database.
      *
@@ -663,7 +6514,7 @@ private:
         try {
             Utils::setConsoleTextColor(m_uiColor);
             std::cout << "Preparing database..." << std::endl << std::endl;
-            m_database.buildDatabaseFromFile(m_inputFileName);
+            buildDatabase();
             std::cout << "Input file read successfully." << std::endl << std::endl;
             m_database.writeDatabaseBackup(m_outputFileName);
             std::cout << "Database backup written successfully." << std::endl << std::endl;
@@ -677,38 +6528,23 @@ private:
     }
 
     /**
-     * Gets heatmap color.
+     * Gets the heatmap color of an item.
      *
-     * @param t_count the count of the item
+     * @param t_id the id of the item
      * @return the heatmap color
      */
-    std::string getHeatmapColor(int t_count) {
-        // Calculate the index of the color to use by scaling the count to the range of the color array
-        // then dividing by the max item count so the colors are evenly distributed
-        int maxItemCount = m_database.getMaxItemCount();
-        int colorCount = m_heatMapColors.size();
-        int colorIndex = std::round((t_count / static_cast<double>(maxItemCount)) * colorCount) - 1;
-        // clamp the color index to the range of the color array
-        colorIndex = (colorIndex < 0) ? 0 : (colorIndex > colorCount ? colorCount : colorIndex);
-        return m_heatMapColors[colorIndex];
+    ConsoleColor getHeatmapColor(ItemTable::ItemId t_id) const {
+        return m_heatMapColors[m_database.getHeatMap().bucket(t_id)];
     }
 
     /**
-     * Prints the color key.
+     * Gets the heatmap color of a count that is not an item's total, such as a windowed count.
+     *
+     * @param t_count the count
+     * @return the heatmap color
      */
-    void printColorKey() {
-        Utils::setConsoleTextColor(m_uiColor);
-        std::string histogramChar = "█";  // Full block Unicode character
-        int maxItemCount = m_database.getMaxItemCount();
-
-        // Print the color key
-        std::cout << "Color Key: 1 ";
-        for (const auto& color : m_heatMapColors) {
-            Utils::setConsoleTextColor(color);
-            std::cout << histogramChar;
-        }
-        Utils::setConsoleTextColor(m_uiColor);
-        std::cout << " " << maxItemCount << std::endl;
+    ConsoleColor getHeatmapColorOfCount(int t_count) const {
+        return m_heatMapColors[m_database.getHeatMap().bucketOf(t_count)];
     }
 
     /**
@@ -728,37 +6564,198 @@ private:
             return;
         }
 
-        // Try to get the count of the item
+        // Try to get the count of the item, offering the closest names for typos
         int count;
         if (!m_database.tryGetItemCount(item, count)) {
-            std::cout << std::endl << "Item not found" << std::endl << std::endl;
+            std::cout << std::endl << "Item not found" << std::endl;
+            std::vector<ItemTable::ItemId> suggestions = m_database.findSimilarItems(item, 5);
+            if (!suggestions.empty()) {
+                std::cout << std::endl << "Did you mean:" << std::endl;
+                printItemList(suggestions);
+            }
+            std::cout << std::endl;
+            Utils::waitForEnter();
+            return;
+        }
+
+        // Print the item and count, then its count in each store
+        Utils::setConsoleTextColor(getHeatmapColorOfCount(count));
+        std::cout << std::endl << Utils::centerStrings(item, std::to_string(count), m_displayWidth) << std::endl << std::endl;
+        ItemTable::ItemId id;
+        if (m_database.getStoreCount() > 0 && m_database.tryFindItem(item, id)) {
+            Utils::setConsoleTextColor(m_uiColor);
+            for (size_t store = 0; store < m_database.getStoreCount(); store++) {
+                std::cout << Utils::centerStrings(m_database.getStoreName(store), std::to_string(m_database.getStoreItemCount(store, id)), m_displayWidth) << std::endl;
+            }
+            std::cout << std::endl;
+        }
+        Utils::setConsoleTextColor(m_uiColor);
+        Utils::waitForEnter();
+    }
+
+    /**
+     * Lists the best selling items whose names start with what the user typed.
+     */
+    void searchForItemsByPrefix() {
+        Utils::setConsoleTextColor(m_uiColor);
+        std::string prefix;
+
+        // Get the start of the item name from the user
+        std::cout << std::endl << "Enter the start of the item name: ";
+        std::getline(std::cin, prefix);
+        prefix = Utils::trim(prefix);
+        if (prefix.empty()) {
+            std::cout << std::endl << "Invalid item name" << std::endl << std::endl;
             Utils::waitForEnter();
             return;
         }
-
-        // Print the item and count
-        Utils::setConsoleTextColor(getHeatmapColor(count));
-        std::cout << std::endl << Utils::centerStrings(item, std::to_string(count), m_displayWidth) << std::endl << std::endl;
+
+        std::vector<ItemTable::ItemId> matches = m_database.findItemsByPrefix(prefix, 10);
+        if (matches.empty()) {
+            std::cout << std::endl << "No items found" << std::endl << std::endl;
+            Utils::waitForEnter();
+            return;
+        }
+        std::cout << std::endl;
+        printItemList(matches);
+        std::cout << std::endl;
+        Utils::waitForEnter();
+    }
+
+    /**
+     * Displays the best or slowest selling items.
+     *
+     * @param t_best true for the best sellers, false for the slowest
+     */
+    void displayRankedItems(bool t_best) {
+        Utils::setConsoleTextColor(m_uiColor);
+        std::cout << std::endl;
+        int count = Utils::getIntegerInput("How many items (1-100): ", "Invalid number of items", 1, 100);
+        std::vector<ItemTable::ItemId> items = t_best ? m_database.getTopItems(count) : m_database.getBottomItems(count);
+        std::cout << std::endl;
+        printItemList(items);
+        std::cout << std::endl;
+        Utils::waitForEnter();
+    }
+
+    /**
+     * Displays the items whose count is within a range the user enters.
+     */
+    void displayItemsByCountRange() {
+        Utils::setConsoleTextColor(m_uiColor);
+        std::cout << std::endl;
+        int minCount = Utils::getIntegerInput("Lowest count: ", "Invalid count", 1);
+        int maxCount = Utils::getIntegerInput("Highest count: ", "Invalid count", minCount);
+        std::vector<ItemTable::ItemId> items = m_database.getItemsInCountRange(minCount, maxCount, m_database.getItemTotal());
+        std::cout << std::endl;
+        if (items.empty()) {
+            std::cout << "No items found" << std::endl;
+        } else {
+            printItemList(items);
+        }
+        std::cout << std::endl;
+        Utils::waitForEnter();
+    }
+
+    /**
+     * Displays the best sellers over the last few hours of timestamped input.
+     */
+    void displayRecentBestSellers() {
+        Utils::setConsoleTextColor(m_uiColor);
+        std::cout << std::endl;
+        if (m_database.getLatestTime() < 0) {
+            std::cout << "No timestamped sales found" << std::endl << std::endl;
+            Utils::waitForEnter();
+            return;
+        }
+        int hours = Utils::getIntegerInput("How many hours (1-8760): ", "Invalid number of hours", 1, 8760);
+        std::cout << std::endl << "Best sellers in the " << hours << " hours before " << Utils::formatTimestamp(m_database.getLatestTime()) << std::endl << std::endl;
+        printItemList(m_database.getRecentTopItems(hours, false, 10), [&](ItemTable::ItemId t_id) {
+            return static_cast<int>(m_database.getRecentItemCount(t_id, hours, false));
+        });
+        std::cout << std::endl;
+        Utils::waitForEnter();
+    }
+
+    /**
+     * Prints items with their counts in heatmap colors.
+     *
+     * @param t_ids the items to print, in order
+     */
+    void printItemList(const std::vector<ItemTable::ItemId>& t_ids) {
+        printItemList(t_ids, [this](ItemTable::ItemId t_id) {
+            return m_database.getItemCount(t_id);
+        });
+    }
+
+    /**
+     * Prints items with counts from a function in heatmap colors.
+     *
+     * @param t_ids the items to print, in order
+     * @param t_countOf called with each item id to get the count to show
+     */
+    template <typename CountFunction>
+    void printItemList(const std::vector<ItemTable::ItemId>& t_ids, CountFunction t_countOf) {
+        ScopedTimer timer("render item list");
+        BufferedWriter output(stdout);
+        for (ItemTable::ItemId id : t_ids) {
+            int count = t_countOf(id);
+            output.setColor(getHeatmapColorOfCount(count));
+            output.write(Utils::centerStrings(m_database.getItemName(id).str(), std::to_string(count), m_displayWidth));
+            output.write('\n');
+        }
+        output.setColor(m_uiColor);
+        output.flush();
+    }
+
+    /**
+     * Shows a full item report, reusing the last rendered frame if nothing has changed.
+     *
+     * @param t_view the report to show
+     */
+    void displayReport(ReportRenderer::View t_view) {
+        int rows;
+        int columns;
+        Utils::getTerminalSize(rows, columns);
+        int width = std::min(m_displayWidth, columns);
+        ReportRenderer::draw(m_reportRenderer.getFrame(m_database, t_view, width, m_heatMapColors, m_uiColor));
+    }
+
+    /**
+     * Shows a full item report in the scrolling viewer if it does not fit on the screen
+     * and the console can read single keys.
+     *
+     * @param t_view the report to show
+     * @return true if the viewer was shown, false if the report should be printed instead
+     */
+    bool tryDisplayReportPaged(ReportRenderer::View t_view) {
+        int rows;
+        int columns;
+        Utils::getTerminalSize(rows, columns);
+        if (!Utils::isOutputTerminal() || !ItemViewer::isNeeded(m_database.getItemTotal(), rows)) {
+            return false;
+        }
+        Keyboard keyboard;
+        if (!keyboard.isActive()) {
+            return false;
+        }
+        ItemViewer viewer(m_database, t_view);
+        viewer.run(keyboard, m_displayWidth, m_heatMapColors, m_uiColor);
         Utils::setConsoleTextColor(m_uiColor);
-        Utils::waitForEnter();
+        return true;
     }
 
     /**
      * Displays the count of all items numerically.
      */
     void displayCountOfAllItemsNumerical() {
-        std::map<std::string, int> itemCounts = m_database.getItemCounts();
-
-        // Print the item and count
-        for (const auto& item : itemCounts) {
-            Utils::setConsoleTextColor(getHeatmapColor(item.second));
-            std::cout << Utils::centerStrings(item.first, std::to_string(item.second), m_displayWidth) << std::endl;
-            Utils::setConsoleTextColor(m_uiColor);
+        if (tryDisplayReportPaged(ReportRenderer::NUMERICAL)) {
+            return;
+        }
+        {
+            ScopedTimer timer("render numerical");
+            displayReport(ReportRenderer::NUMERICAL);
         }
-        std::cout << std::endl;
-
-        // Print the color key
-        printColorKey();
         Utils::setConsoleTextColor(m_uiColor);
         std::cout << std::endl;
         Utils::waitForEnter();
@@ -768,19 +6765,13 @@ private:
      * Displays the count of all items in a histogram.
      */
     void displayCountOfAllItemsHistogram() {
-        std::string histogramChar = "█";  // Full block Unicode character
-        std::map<std::string, int> itemCounts = m_database.getItemCounts();
-
-        // Print the item and count
-        for (const auto& item : itemCounts) {
-            Utils::setConsoleTextColor(getHeatmapColor(item.second));
-            std::cout << Utils::centerStrings(item.first, Utils::repeatString(histogramChar, item.second), m_displayWidth) << std::endl;
-            Utils::setConsoleTextColor(m_uiColor);
+        if (tryDisplayReportPaged(ReportRenderer::HISTOGRAM)) {
+            return;
+        }
+        {
+            ScopedTimer timer("render histogram");
+            displayReport(ReportRenderer::HISTOGRAM);
         }
-        std::cout << std::endl;
-
-        // Print the color key
-        printColorKey();
         Utils::setConsoleTextColor(m_uiColor);
         std::cout << std::endl;
         Utils::waitForEnter();
@@ -814,6 +6805,21 @@ private:
                 case 3:
                     displayCountOfAllItemsHistogram();
                     break;
+                case 4:
+                    searchForItemsByPrefix();
+                    break;
+                case 5:
+                    displayRankedItems(true);
+                    break;
+                case 6:
+                    displayRankedItems(false);
+                    break;
+                case 7:
+                    displayItemsByCountRange();
+                    break;
+                case 8:
+                    displayRecentBestSellers();
+                    break;
                 default:
                     std::cout << "Invalid choice" << std::endl;
             }
@@ -821,7 +6827,797 @@ private:
         }
     }
 
+    /**
+     * Writes a string as a JSON string literal.
+     *
+     * @param t_output the writer to write to
+     * @param t_str the string to write
+     */
+    static void writeJsonString(BufferedWriter& t_output, StringView t_str) {
+        t_output.write('"');
+        for (size_t i = 0; i < t_str.size(); i++) {
+            char c = t_str.data()[i];
+            if (c == '"' || c == '\\') {
+                t_output.write('\\');
+                t_output.write(c);
+            } else if (static_cast<unsigned char>(c) < 0x20) {
+                const char* hexDigits = "0123456789abcdef";
+                t_output.write("\\u00");
+                t_output.write(hexDigits[(c >> 4) & 0xF]);
+                t_output.write(hexDigits[c & 0xF]);
+            } else {
+                t_output.write(c);
+            }
+        }
+        t_output.write('"');
+    }
+
+    /**
+     * Writes a string as a CSV field, quoting it if needed.
+     *
+     * @param t_output the writer to write to
+     * @param t_str the string to write
+     */
+    static void writeCsvField(BufferedWriter& t_output, StringView t_str) {
+        bool needsQuotes = false;
+        for (size_t i = 0; i < t_str.size() && !needsQuotes; i++) {
+            char c = t_str.data()[i];
+            needsQuotes = c == ',' || c == '"' || c == '\n' || c == '\r';
+        }
+        if (!needsQuotes) {
+            t_output.write(t_str);
+            return;
+        }
+        t_output.write('"');
+        for (size_t i = 0; i < t_str.size(); i++) {
+            if (t_str.data()[i] == '"') {
+                t_output.write('"');
+            }
+            t_output.write(t_str.data()[i]);
+        }
+        t_output.write('"');
+    }
+
+    /**
+     * Writes one item record in the selected output format.
+     *
+     * @param t_output the writer to write to
+     * @param t_name the item name
+     * @param t_count the item count
+     * @param t_found false if the item is not in the database
+     * @param t_first true for the first record of a JSON array
+     */
+    void writeBatchRecord(BufferedWriter& t_output, StringView t_name, int t_count, bool t_found, bool t_first) {
+        if (m_outputFormat == "json") {
+            t_output.write(t_first ? "\n    {\"item\": " : ",\n    {\"item\": ");
+            writeJsonString(t_output, t_name);
+            t_output.write(", \"count\": ");
+            t_output.writeNumber(t_count);
+            t_output.write(t_found ? ", \"found\": true}" : ", \"found\": false}");
+        } else if (m_outputFormat == "csv") {
+            writeCsvField(t_output, t_name);
+            t_output.write(',');
+            if (t_found) {
+                t_output.writeNumber(t_count);
+            }
+            t_output.write('\n');
+        } else if (!t_found) {
+            t_output.write(t_name);
+            t_output.write(" not found\n");
+        } else if (m_reportType == "histogram") {
+            t_output.write(t_name);
+            t_output.write(' ');
+            for (int i = 0; i < t_count; i++) {
+                t_output.write("█");
+            }
+            t_output.write('\n');
+        } else {
+            t_output.write(t_name);
+            t_output.write(' ');
+            t_output.writeNumber(t_count);
+            t_output.write('\n');
+        }
+    }
+
+    /**
+     * Starts a named section of batch output. Only JSON marks sections; text and CSV
+     * records simply follow each other.
+     *
+     * @param t_output the writer to write to
+     * @param t_key the JSON key of the section
+     * @param t_firstSection true until the first section is started, then cleared
+     */
+    void beginBatchSection(BufferedWriter& t_output, const char* t_key, bool& t_firstSection) {
+        if (m_outputFormat == "json") {
+            t_output.write(t_firstSection ? "\n  \"" : ",\n  \"");
+            t_output.write(t_key);
+            t_output.write("\": [");
+        }
+        t_firstSection = false;
+    }
+
+    /**
+     * Ends a section started by beginBatchSection().
+     *
+     * @param t_output the writer to write to
+     */
+    void endBatchSection(BufferedWriter& t_output) {
+        if (m_outputFormat == "json") {
+            t_output.write("\n  ]");
+        }
+    }
+
+    /**
+     * Writes a section of batch output listing items with their counts.
+     *
+     * @param t_output the writer to write to
+     * @param t_key the JSON key of the section
+     * @param t_ids the items to write, in order
+     * @param t_firstSection true until the first section is started, then cleared
+     */
+    void writeBatchSection(BufferedWriter& t_output, const char* t_key, const std::vector<ItemTable::ItemId>& t_ids, bool& t_firstSection) {
+        beginBatchSection(t_output, t_key, t_firstSection);
+        for (size_t i = 0; i < t_ids.size(); i++) {
+            writeBatchRecord(t_output, m_database.getItemName(t_ids[i]), m_database.getItemCount(t_ids[i]), true, i == 0);
+        }
+        endBatchSection(t_output);
+    }
+
+    /**
+     * Writes the per store counts of the queried items, or of every item when nothing was
+     * queried, as records named store:item. Queried items not in the database are skipped.
+     *
+     * @param t_output the writer to write to
+     * @param t_firstSection true until the first section is started, then cleared
+     */
+    void writeStoreSection(BufferedWriter& t_output, bool& t_firstSection) {
+        std::vector<ItemTable::ItemId> ids;
+        if (m_queries.empty()) {
+            ids = m_database.getItemsByName();
+        }
+        for (const std::string& query : m_queries) {
+            ItemTable::ItemId id;
+            if (m_database.tryFindItem(query, id)) {
+                ids.push_back(id);
+            }
+        }
+
+        beginBatchSection(t_output, "stores", t_firstSection);
+        bool first = true;
+        for (size_t store = 0; store < m_database.getStoreCount(); store++) {
+            for (ItemTable::ItemId id : ids) {
+                std::string name = m_database.getStoreName(store) + ":" + m_database.getItemName(id).str();
+                writeBatchRecord(t_output, name, m_database.getStoreItemCount(store, id), true, first);
+                first = false;
+            }
+        }
+        endBatchSection(t_output);
+    }
+
+    /**
+     * Signal handler that asks the watch loop to stop.
+     */
+    static void requestStop(int) {
+        s_stopRequested = 1;
+    }
+
+    /**
+     * Formats the rows of the live view, one string per terminal line including its color.
+     *
+     * @param t_rows the number of terminal rows available
+     * @param t_columns the number of terminal columns available
+     * @return the lines of the frame
+     */
+    std::vector<std::string> buildWatchFrame(int t_rows, int t_columns) {
+        std::vector<std::string> frame;
+        char timeText[16];
+        std::time_t now = std::time(nullptr);
+        std::strftime(timeText, sizeof(timeText), "%H:%M:%S", std::localtime(&now));
+        frame.push_back(std::string(Utils::getConsoleColorCode(m_uiColor)) + "Watching " + m_inputFileNames.front() + " - " +
+                        std::to_string(m_database.getItemTotal()) + " items - updated " + timeText + " - Ctrl+C to stop");
+        frame.push_back("");
+
+        // Rows that do not fit on the screen are not formatted at all
+        int width = std::min(m_displayWidth, t_columns);
+        size_t barRoom = ReportRenderer::barRoom(width);
+        int maxCount = m_database.getMaxItemCount();
+        const std::vector<ItemTable::ItemId>& items = m_database.getItemsByName();
+        size_t visibleRows = t_rows > 3 ? static_cast<size_t>(t_rows - 3) : 0;
+        for (size_t i = 0; i < items.size() && i < visibleRows; i++) {
+            int count = m_database.getItemCount(items[i]);
+            std::string value;
+            if (m_reportType == "histogram") {
+                value = Utils::repeatString(ReportRenderer::BLOCK, static_cast<int>(ReportRenderer::barLength(count, maxCount, barRoom)));
+            } else {
+                value = std::to_string(count);
+            }
+            frame.push_back(Utils::getConsoleColorCode(getHeatmapColor(items[i])) + Utils::centerStrings(m_database.getItemName(items[i]).str(), value, width));
+        }
+        if (items.size() > visibleRows) {
+            frame.push_back(std::string(Utils::getConsoleColorCode(m_uiColor)) + "... " + std::to_string(items.size() - visibleRows) + " more items");
+        }
+        return frame;
+    }
+
+    /**
+     * Draws a frame, repainting only the lines that differ from the frame on screen.
+     *
+     * @param t_frame the frame to draw
+     * @param t_shown the frame on screen, updated to t_frame
+     */
+    static void drawWatchFrame(const std::vector<std::string>& t_frame, std::vector<std::string>& t_shown) {
+        BufferedWriter output(stdout);
+        size_t lineCount = std::max(t_frame.size(), t_shown.size());
+        for (size_t i = 0; i < lineCount; i++) {
+            if (i < t_frame.size() && i < t_shown.size() && t_frame[i] == t_shown[i]) {
+                continue;
+            }
+            // Move to the start of the line, write it and clear what is left of the old line
+            output.write("\033[");
+            output.writeNumber(static_cast<long long>(i + 1));
+            output.write(";1H");
+            if (i < t_frame.size()) {
+                output.write(t_frame[i]);
+            }
+            output.write("\033[K");
+        }
+        output.flush();
+        t_shown = t_frame;
+    }
+
+    /**
+     * Prints the command line usage.
+     *
+     * @param t_output the stream to print to
+     * @param t_programName the name the program was run as
+     */
+    static void printUsage(std::ostream& t_output, const std::string& t_programName) {
+        t_output << "Usage: " << t_programName << " [options]" << std::endl
+                 << "  --threads N         count the input file on N threads, 0 uses one per core" << std::endl
+                 << "  --rebuild           count the whole input file instead of resuming from the last backup" << std::endl
+                 << "  --batch             run without the menu and write results to stdout" << std::endl
+                 << "  --input PATH[,..]   input files, patterns or a pipe, may be repeated; - reads standard input (default CS210_Project_Three_Input_File.txt)" << std::endl
+                 << "  --stats             print timings, throughput, peak memory and allocations on exit" << std::endl
+                 << "  --stats-json PATH   save the same statistics as JSON on exit" << std::endl
+                 << "  --by-store          keep the counts of each input file apart and print them per store" << std::endl
+                 << "  --approximate E[,F] count in fixed memory, off by at most E of all sales with probability 1 - F (default F 0.01)" << std::endl
+                 << "  --output PATH       backup file (default frequency.dat)" << std::endl
+                 << "  --no-backup         do not write the backup file" << std::endl
+                 << "  --query ITEM[,..]   print the count of items, may be repeated (implies --batch)" << std::endl
+                 << "  --prefix TEXT       print the best selling items starting with TEXT (implies --batch)" << std::endl
+                 << "  --suggest TEXT      print the items with names closest to TEXT (implies --batch)" << std::endl
+                 << "  --limit K           most results for --prefix, --suggest and --window (default 10)" << std::endl
+                 << "  --top K             print the K best selling items (implies --batch)" << std::endl
+                 << "  --bottom K          print the K slowest selling items (implies --batch)" << std::endl
+                 << "  --range MIN-MAX     print the items with a count from MIN to MAX (implies --batch)" << std::endl
+                 << "  --timestamps        lines may start with a time, ISO 8601 or 9 to 10 digit Unix seconds, to count sales per hour and day" << std::endl
+                 << "  --window N[h|d]     print the --query items, or the best sellers, over the last N hours or days (implies --batch)" << std::endl
+                 << "  --report TYPE       numerical, histogram or none (implies --batch)" << std::endl
+                 << "  --format FORMAT     text, csv or json (default text)" << std::endl
+                 << "  --watch             follow the input file and keep the --report view up to date" << std::endl
+                 << "  --fps N             refresh rate of --watch, 1 to 60 (default 4)" << std::endl
+                 << "  --serve             build the database once and answer --client requests over the --socket file" << std::endl
+                 << "  --socket PATH       socket file of --serve and --client (default inventory.sock)" << std::endl
+                 << "  --client REQUEST    send a request to a running --serve and print the reply, may be repeated:" << std::endl
+                 << "                      COUNT ITEM, TOP [K], BOTTOM [K], PREFIX TEXT [K], DUMP, PING or QUIT" << std::endl
+                 << "  --heat-scale SCALE  how counts map to colors: linear, log or quantile (default linear)" << std::endl
+                 << "  --help, -h          print this help and exit" << std::endl;
+    }
+
 public:
+    /**
+     * Parses the command line arguments.
+     * With no arguments the interactive menu is used; see printUsage() for the options.
+     *
+     * @param t_argc the argument count
+     * @param t_argv the argument values
+     * @return true if the arguments are valid, false otherwise
+     */
+    bool parseArguments(int t_argc, char* t_argv[]) {
+        for (int i = 1; i < t_argc; i++) {
+            std::string argument = t_argv[i];
+            bool hasValue = i + 1 < t_argc;
+            unsigned long long number;
+            if (argument == "--help" || argument == "-h") {
+                printUsage(std::cout, t_argv[0]);
+                m_helpRequested = true;
+                return true;
+            } else if (argument == "--threads" && hasValue) {
+                std::string value = t_argv[++i];
+                if (!Utils::tryParseUnsigned(value, 1024, number)) {
+                    std::cerr << "Invalid thread count: " << value << std::endl;
+                    return false;
+                }
+                m_threadCount = static_cast<unsigned int>(number);
+            } else if (argument == "--rebuild") {
+                m_rebuild = true;
+            } else if (argument == "--batch") {
+                m_batchMode = true;
+            } else if (argument == "--input" && hasValue) {
+                // The first --input replaces the default file; a list, patterns and repeats add to it
+                if (!m_hasInputArgument) {
+                    m_inputFileNames.clear();
+                    m_hasInputArgument = true;
+                }
+                std::string inputs = t_argv[++i];
+                size_t start = 0;
+                while (start <= inputs.length()) {
+                    size_t comma = inputs.find(',', start);
+                    std::string input = Utils::trim(inputs.substr(start, comma == std::string::npos ? std::string::npos : comma - start));
+                    if (!input.empty()) {
+                        std::vector<std::string> fileNames = Utils::expandFilePattern(input);
+                        m_inputFileNames.insert(m_inputFileNames.end(), fileNames.begin(), fileNames.end());
+                    }
+                    start = comma == std::string::npos ? inputs.length() + 1 : comma + 1;
+                }
+
+                // Standard input carries the data, so it cannot also answer the menu
+                if (std::find(m_inputFileNames.begin(), m_inputFileNames.end(), "-") != m_inputFileNames.end()) {
+                    m_batchMode = true;
+                }
+            } else if (argument == "--approximate" && hasValue) {
+                // ERROR[,FAILURE] as fractions, such as 0.001,0.01
+                std::string value = t_argv[++i];
+                size_t comma = value.find(',');
+                double error = 0;
+                double failureRate = 0.01;
+                if (!Utils::tryParseFraction(value.substr(0, comma), error) || error < 0.000001 ||
+                    (comma != std::string::npos && !Utils::tryParseFraction(value.substr(comma + 1), failureRate))) {
+                    std::cerr << "Invalid error bound: " << value << std::endl;
+                    return false;
+                }
+                m_database.setApproximate(error, failureRate);
+            } else if (argument == "--stats") {
+                m_printStats = true;
+                Instrumentation::enable();
+            } else if (argument == "--stats-json" && hasValue) {
+                m_statsFileName = t_argv[++i];
+                Instrumentation::enable();
+            } else if (argument == "--by-store") {
+                m_byStore = true;
+                m_database.setKeepStoreCounts(true);
+            } else if (argument == "--output" && hasValue) {
+                m_outputFileName = t_argv[++i];
+            } else if (argument == "--no-backup") {
+                m_writeBackup = false;
+            } else if (argument == "--query" && hasValue) {
+                // Accept a comma separated list as well as repeated options
+                std::string queries = t_argv[++i];
+                size_t start = 0;
+                while (start <= queries.length()) {
+                    size_t comma = queries.find(',', start);
+                    std::string query = Utils::trim(queries.substr(start, comma == std::string::npos ? std::string::npos : comma - start));
+                    if (!query.empty()) {
+                        m_queries.push_back(query);
+                    }
+                    start = comma == std::string::npos ? queries.length() + 1 : comma + 1;
+                }
+                m_batchMode = true;
+            } else if ((argument == "--prefix" || argument == "--suggest") && hasValue) {
+                std::string text = Utils::trim(t_argv[++i]);
+                if (text.empty()) {
+                    std::cerr << "Invalid " << argument.substr(2) << " text" << std::endl;
+                    return false;
+                }
+                (argument == "--prefix" ? m_prefixQuery : m_suggestQuery) = text;
+                m_batchMode = true;
+            } else if (argument == "--limit" && hasValue) {
+                std::string value = t_argv[++i];
+                if (!Utils::tryParseUnsigned(value, 1000000, number) || number == 0) {
+                    std::cerr << "Invalid result limit: " << value << std::endl;
+                    return false;
+                }
+                m_resultLimit = static_cast<size_t>(number);
+            } else if ((argument == "--top" || argument == "--bottom") && hasValue) {
+                std::string value = t_argv[++i];
+                if (!Utils::tryParseUnsigned(value, 1000000, number) || number == 0) {
+                    std::cerr << "Invalid item count: " << value << std::endl;
+                    return false;
+                }
+                (argument == "--top" ? m_topCount : m_bottomCount) = static_cast<size_t>(number);
+                m_batchMode = true;
+            } else if (argument == "--range" && hasValue) {
+                std::string value = t_argv[++i];
+                size_t dash = value.find('-');
+                unsigned long long maxCount;
+                if (dash == std::string::npos || !Utils::tryParseUnsigned(value.substr(0, dash), INT_MAX, number) ||
+                    !Utils::tryParseUnsigned(value.substr(dash + 1), INT_MAX, maxCount) || number > maxCount) {
+                    std::cerr << "Invalid count range: " << value << std::endl;
+                    return false;
+                }
+                m_hasCountRange = true;
+                m_countRangeMin = static_cast<int>(number);
+                m_countRangeMax = static_cast<int>(maxCount);
+                m_batchMode = true;
+            } else if (argument == "--timestamps") {
+                m_database.setTimestamps(true);
+            } else if (argument == "--window" && hasValue) {
+                std::string value = t_argv[++i];
+                m_windowInDays = !value.empty() && value.back() == 'd';
+                std::string length = !value.empty() && (value.back() == 'd' || value.back() == 'h') ? value.substr(0, value.length() - 1) : value;
+                if (!Utils::tryParseUnsigned(length, 1000000, number) || number == 0) {
+                    std::cerr << "Invalid window: " << value << std::endl;
+                    return false;
+                }
+                m_windowLength = static_cast<long long>(number);
+                m_batchMode = true;
+            } else if (argument == "--report" && hasValue) {
+                m_reportType = t_argv[++i];
+                if (m_reportType != "numerical" && m_reportType != "histogram" && m_reportType != "none") {
+                    std::cerr << "Invalid report type: " << m_reportType << std::endl;
+                    return false;
+                }
+                m_batchMode = true;
+            } else if (argument == "--serve") {
+                m_serveMode = true;
+            } else if (argument == "--socket" && hasValue) {
+                m_socketPath = t_argv[++i];
+            } else if (argument == "--client" && hasValue) {
+                m_clientRequests.push_back(t_argv[++i]);
+            } else if (argument == "--watch") {
+                m_watchMode = true;
+            } else if (argument == "--fps" && hasValue) {
+                std::string value = t_argv[++i];
+                if (!Utils::tryParseUnsigned(value, 60, number) || number == 0) {
+                    std::cerr << "Invalid frame rate: " << value << std::endl;
+                    return false;
+                }
+                m_frameRate = static_cast<unsigned int>(number);
+            } else if (argument == "--heat-scale" && hasValue) {
+                std::string value = t_argv[++i];
+                if (!HeatMap::tryParseScale(value, m_heatScale)) {
+                    std::cerr << "Invalid heat scale: " << value << std::endl;
+                    return false;
+                }
+            } else if (argument == "--format" && hasValue) {
+                m_outputFormat = t_argv[++i];
+                if (m_outputFormat != "text" && m_outputFormat != "csv" && m_outputFormat != "json") {
+                    std::cerr << "Invalid output format: " << m_outputFormat << std::endl;
+                    return false;
+                }
+            } else {
+                std::cerr << "Unknown argument: " << argument << std::endl;
+                printUsage(std::cerr, t_argv[0]);
+                return false;
+            }
+        }
+        if (m_windowLength > 0 && !m_database.hasTimestamps()) {
+            std::cerr << "--window needs --timestamps" << std::endl;
+            return false;
+        }
+        if (m_database.isApproximate() && (m_database.hasTimestamps() || m_byStore || m_watchMode)) {
+            std::cerr << "--approximate cannot be combined with --timestamps, --by-store or --watch" << std::endl;
+            return false;
+        }
+        if (m_inputFileNames.empty()) {
+            std::cerr << "No input file given" << std::endl;
+            return false;
+        }
+        if (m_watchMode && (m_inputFileNames.size() > 1 || m_byStore)) {
+            std::cerr << "--watch follows a single --input file" << std::endl;
+            return false;
+        }
+        if (m_watchMode && Database::isStreamInput(m_inputFileNames.front())) {
+            std::cerr << "--watch follows a file as it grows; standard input and pipes are counted once they end" << std::endl;
+            return false;
+        }
+        if (m_serveMode && (m_watchMode || !m_clientRequests.empty())) {
+            std::cerr << "--serve cannot be combined with --watch or --client" << std::endl;
+            return false;
+        }
+        if (m_database.hasTimestamps()) {
+            m_mainMenuOptions.insert(m_mainMenuOptions.end() - 1, "Display Best Sellers in Recent Hours");
+        }
+        return true;
+    }
+
+    /**
+     * Prints the --stats report to stderr and saves the --stats-json file, if either was asked for.
+     */
+    void writeStats() {
+        if (m_printStats) {
+            Instrumentation::writeReport(std::cerr);
+        }
+        if (!m_statsFileName.empty() && !Instrumentation::writeJson(m_statsFileName)) {
+            std::cerr << "Could not save " << m_statsFileName << std::endl;
+        }
+    }
+
+    /**
+     * Checks if the arguments selected the non-interactive batch mode.
+     *
+     * @return true if RunBatch() should be used instead of Start()
+     */
+    bool isBatchMode() const {
+        return m_batchMode;
+    }
+
+    /**
+     * Checks if the arguments selected the query server mode.
+     *
+     * @return true if RunServer() should be used instead of Start()
+     */
+    bool isServeMode() const {
+        return m_serveMode;
+    }
+
+    /**
+     * Checks if the arguments only asked for the usage, which parseArguments() already printed.
+     *
+     * @return true if the program should exit without doing anything else
+     */
+    bool isHelpRequested() const {
+        return m_helpRequested;
+    }
+
+    /**
+     * Checks if the arguments asked to query a running server.
+     *
+     * @return true if RunClient() should be used instead of Start()
+     */
+    bool isClientMode() const {
+        return !m_clientRequests.empty();
+    }
+
+    /**
+     * Checks if the arguments selected the live watch mode.
+     *
+     * @return true if RunWatch() should be used instead of Start()
+     */
+    bool isWatchMode() const {
+        return m_watchMode;
+    }
+
+    /**
+     * Follows the input file as it grows and redraws the --report view at the frame rate.
+     * New bytes are counted incrementally, and only lines that changed are repainted.
+     * Runs until interrupted with Ctrl+C, then writes the backup.
+     *
+     * @return the process exit code, 0 on success, 1 on error
+     */
+    int RunWatch() {
+        // Watch mode may run unattended, so an error ends it instead of waiting for Enter
+        try {
+            buildDatabase();
+            m_database.writeDatabaseBackup(m_outputFileName);
+        } catch (const Database::DatabaseError& e) {
+            Utils::setConsoleTextColor(COLOR_WHITE);
+            std::cerr << "Fatal Error: " << e.what() << std::endl;
+            return 1;
+        }
+        FileWatcher watcher;
+        watcher.open(m_inputFileNames.front());
+        s_stopRequested = 0;
+        std::signal(SIGINT, requestStop);
+
+        // Hide the cursor and start from a clear screen
+        Utils::enableEscapeSequences();
+        std::cout << "\033[?25l\033[2J" << std::flush;
+        const std::chrono::milliseconds frameInterval(1000 / m_frameRate);
+        std::vector<std::string> shownFrame;
+        size_t shownVersion = m_database.getVersion() + 1;
+        int shownRows = 0;
+        int shownColumns = 0;
+        while (!s_stopRequested) {
+            auto frameStart = std::chrono::steady_clock::now();
+
+            // Redraw when the counts or the terminal size changed; a resize repaints everything
+            int rows;
+            int columns;
+            Utils::getTerminalSize(rows, columns);
+            if (rows != shownRows || columns != shownColumns) {
+                std::cout << "\033[2J" << std::flush;
+                shownFrame.clear();
+                shownRows = rows;
+                shownColumns = columns;
+                shownVersion = m_database.getVersion() + 1;
+            }
+            if (shownVersion != m_database.getVersion()) {
+                ScopedTimer timer("render watch frame");
+                drawWatchFrame(buildWatchFrame(rows, columns), shownFrame);
+                shownVersion = m_database.getVersion();
+            }
+
+            // Wait for new data, then hold the rest of the frame so bursts of appends are batched
+            if (watcher.waitForChange(frameInterval)) {
+                m_database.updateFromFile(m_inputFileNames.front());
+            }
+            std::this_thread::sleep_until(frameStart + frameInterval);
+        }
+        std::signal(SIGINT, SIG_DFL);
+
+        // Restore the cursor below the view and save what was counted
+        std::cout << "\033[" << shownFrame.size() + 1 << ";1H\033[?25h" << std::endl;
+        try {
+            m_database.writeDatabaseBackup(m_outputFileName);
+        } catch (const Database::DatabaseError& e) {
+            std::cerr << "Fatal Error: " << e.what() << std::endl;
+            return 1;
+        }
+        Utils::setConsoleTextColor(COLOR_WHITE);
+        return 0;
+    }
+
+    /**
+     * Builds the database once and answers requests from --client and other local processes
+     * over the --socket file until interrupted with Ctrl+C. Progress messages go to stderr.
+     *
+     * @return the process exit code, 0 on success, 1 on error
+     */
+    int RunServer() {
+        m_database.setStatusStream(std::cerr);
+        try {
+            buildDatabase();
+            if (m_writeBackup) {
+                m_database.writeDatabaseBackup(m_outputFileName);
+            }
+            QueryServer server(m_database);
+            server.listen(m_socketPath);
+            std::cerr << "Serving " << m_database.getItemTotal() << " items on " << m_socketPath << " - Ctrl+C to stop" << std::endl;
+            s_stopRequested = 0;
+            std::signal(SIGINT, requestStop);
+            std::signal(SIGTERM, requestStop);
+            server.run(s_stopRequested);
+            std::signal(SIGINT, SIG_DFL);
+            std::signal(SIGTERM, SIG_DFL);
+        } catch (const Database::DatabaseError& e) {
+            std::cerr << "Fatal Error: " << e.what() << std::endl;
+            return 1;
+        } catch (const QueryServer::ServerError& e) {
+            std::cerr << "Fatal Error: " << e.what() << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    /**
+     * Sends the --client requests to a running server and prints the replies like batch text output.
+     *
+     * @return the process exit code, 0 on success, 1 on error, 2 if a queried item was not found
+     */
+    int RunClient() {
+        int exitCode = 0;
+        size_t requestIndex = 0;
+        BufferedWriter output(stdout);
+        try {
+            QueryServer::sendRequests(m_socketPath, m_clientRequests, [&](const std::string& t_status, const std::vector<std::string>& t_items) {
+                const std::string& request = m_clientRequests[requestIndex++];
+                if (t_status == "NOTFOUND") {
+                    size_t space = request.find(' ');
+                    output.write(space == std::string::npos ? std::string() : Utils::trim(request.substr(space + 1)));
+                    output.write(" not found\n");
+                    exitCode = std::max(exitCode, 2);
+                } else if (t_status.compare(0, 3, "ERR") == 0) {
+                    output.flush();
+                    std::cerr << request << ": " << Utils::trim(t_status.substr(3)) << std::endl;
+                    exitCode = 1;
+                }
+                for (const std::string& item : t_items) {
+                    output.write(item);
+                    output.write('\n');
+                }
+            });
+        } catch (const QueryServer::ServerError& e) {
+            output.flush();
+            std::cerr << "Fatal Error: " << e.what() << std::endl;
+            return 1;
+        }
+        output.flush();
+        return exitCode;
+    }
+
+    /**
+     * Runs without user interaction: builds the database, answers the queries and
+     * prints the report to stdout. Progress messages go to stderr.
+     *
+     * @return the process exit code, 0 on success, 1 on error, 2 if a queried item was not found
+     */
+    int RunBatch() {
+        m_database.setStatusStream(std::cerr);
+        try {
+            buildDatabase();
+            if (m_writeBackup) {
+                m_database.writeDatabaseBackup(m_outputFileName);
+            }
+        } catch (const Database::DatabaseError& e) {
+            std::cerr << "Fatal Error: " << e.what() << std::endl;
+            return 1;
+        }
+
+        ScopedTimer timer("batch output");
+        BufferedWriter output(stdout);
+        bool allFound = true;
+        bool firstSection = true;
+        if (m_outputFormat == "json") {
+            output.write('{');
+        } else if (m_outputFormat == "csv") {
+            output.write("item,count\n");
+        }
+
+        // Answer the queries in the order given
+        if (!m_queries.empty()) {
+            beginBatchSection(output, "queries", firstSection);
+            for (size_t i = 0; i < m_queries.size(); i++) {
+                ItemTable::ItemId id;
+                int estimate;
+                bool found = m_database.tryFindItem(m_queries[i], id);
+                if (found) {
+                    writeBatchRecord(output, m_database.getItemName(id), m_database.getItemCount(id), true, i == 0);
+                } else if (m_database.isApproximate() && m_database.tryGetItemCount(m_queries[i], estimate)) {
+                    found = true;
+                    writeBatchRecord(output, m_queries[i], estimate, true, i == 0);
+                } else {
+                    writeBatchRecord(output, m_queries[i], 0, false, i == 0);
+                }
+                allFound = allFound && found;
+            }
+            endBatchSection(output);
+        }
+
+        // Complete the prefix and suggest corrections
+        if (!m_prefixQuery.empty()) {
+            writeBatchSection(output, "prefix", m_database.findItemsByPrefix(m_prefixQuery, m_resultLimit), firstSection);
+        }
+        if (!m_suggestQuery.empty()) {
+            writeBatchSection(output, "suggestions", m_database.findSimilarItems(m_suggestQuery, m_resultLimit), firstSection);
+        }
+
+        // Rank by count
+        if (m_topCount > 0) {
+            writeBatchSection(output, "top", m_database.getTopItems(m_topCount), firstSection);
+        }
+        if (m_bottomCount > 0) {
+            writeBatchSection(output, "bottom", m_database.getBottomItems(m_bottomCount), firstSection);
+        }
+        if (m_hasCountRange) {
+            writeBatchSection(output, "range", m_database.getItemsInCountRange(m_countRangeMin, m_countRangeMax, m_database.getItemTotal()), firstSection);
+        }
+
+        // Counts over the latest hours or days, for the queried items or else the best sellers
+        if (m_windowLength > 0) {
+            beginBatchSection(output, "window", firstSection);
+            if (m_queries.empty()) {
+                std::vector<ItemTable::ItemId> items = m_database.getRecentTopItems(m_windowLength, m_windowInDays, m_resultLimit);
+                for (size_t i = 0; i < items.size(); i++) {
+                    long long count = m_database.getRecentItemCount(items[i], m_windowLength, m_windowInDays);
+                    writeBatchRecord(output, m_database.getItemName(items[i]), static_cast<int>(count), true, i == 0);
+                }
+            }
+            for (size_t i = 0; i < m_queries.size(); i++) {
+                ItemTable::ItemId id;
+                if (m_database.tryFindItem(m_queries[i], id)) {
+                    long long count = m_database.getRecentItemCount(id, m_windowLength, m_windowInDays);
+                    writeBatchRecord(output, m_database.getItemName(id), static_cast<int>(count), true, i == 0);
+                } else {
+                    writeBatchRecord(output, m_queries[i], 0, false, i == 0);
+                }
+            }
+            endBatchSection(output);
+        }
+
+        // Break the queried items, or else every item, down by the input file they were sold in
+        if (m_database.getStoreCount() > 0) {
+            writeStoreSection(output, firstSection);
+        }
+
+        // Print every item in name order
+        if (m_reportType != "none") {
+            beginBatchSection(output, "items", firstSection);
+            bool first = true;
+            m_database.forEachItem([&](StringView t_name, int t_count) {
+                writeBatchRecord(output, t_name, t_count, true, first);
+                first = false;
+            });
+            endBatchSection(output);
+        }
+
+        if (m_outputFormat == "json") {
+            output.write("\n}\n");
+        }
+        output.flush();
+        return allFound ? 0 : 2;
+    }
+
     /**
      * Starts the inventory analyzer.
      */
@@ -851,13 +7647,17 @@ public:
         std::cout << Utils::centerString("Developed by Chada Tech", m_displayWidth) << std::endl << std::endl;
         Utils::setConsoleTextColor(m_uiColor);
         Utils::waitForEnter();
-        Utils::setConsoleTextColor("white");
+        Utils::setConsoleTextColor(COLOR_WHITE);
     }
 };
 
+volatile std::sig_atomic_t InventoryAnalyzer::s_stopRequested = 0;
+
 // --- Main Function ---
 
-int main() {
+// The benchmarks compile this file into their own programs and bring their own main
+#ifndef INVENTORY_ANALYZER_NO_MAIN
+int main(int argc, char* argv[]) {
     // Set Windows console to UTF-8
     #ifdef _WIN32
         SetConsoleOutputCP(CP_UTF8);
@@ -865,6 +7665,25 @@ int main() {
     #endif
 
     InventoryAnalyzer inventoryAnalyzer;
-    inventoryAnalyzer.Start();
-    return 0;
-}
\ No newline at end of file
+    if (!inventoryAnalyzer.parseArguments(argc, argv)) {
+        return 1;
+    }
+    if (inventoryAnalyzer.isHelpRequested()) {
+        return 0;
+    }
+    int exitCode = 0;
+    if (inventoryAnalyzer.isClientMode()) {
+        exitCode = inventoryAnalyzer.RunClient();
+    } else if (inventoryAnalyzer.isServeMode()) {
+        exitCode = inventoryAnalyzer.RunServer();
+    } else if (inventoryAnalyzer.isWatchMode()) {
+        exitCode = inventoryAnalyzer.RunWatch();
+    } else if (inventoryAnalyzer.isBatchMode()) {
+        exitCode = inventoryAnalyzer.RunBatch();
+    } else {
+        inventoryAnalyzer.Start();
+    }
+    inventoryAnalyzer.writeStats();
+    return exitCode;
+}
+#endif